@@ -0,0 +1,287 @@
+"""Sustained throughput and latency benchmark for the multiverse wire protocol.
+
+Streams frames with data, sdat, zipd or szip (or floods sync) over one TCP session and reports frames/s,
+wire and raw MB/s, compression ratio and p50/p99 latency. What latency means depends on what can be seen
+of the target:
+
+  - a board (--ip/--port): how long each message takes to be taken by the socket. Once the board falls
+    behind, TCP backpressure makes this the time the board takes per message.
+  - the host simulator started with --frames DIR (--ip/--port and --observe DIR): frame to photon, from
+    starting to send a frame to the virtual panel writing it out (send as above for sync). Frames are
+    tagged so each one written can be matched to the one sent; superseded frames never make it to the
+    panel and are counted as such.
+  - a stand-in started in this process (--standin): the time until it has parsed the frame (and inflated
+    it), the way the firmware does, which leaves only the host side and loopback.
+
+    python3 benchmark.py --ip 192.168.1.50 --port 54321 --command sdat szip --content gradient
+    python3 benchmark.py --ip 127.0.0.1 --port 54321 --observe frames --command sdat
+    python3 benchmark.py --standin --content clip --file clip.raw
+"""
+
+import argparse
+import os
+import random
+import socket
+import struct
+import threading
+import time
+import zlib
+
+from matrix import FRAME_SIZE, HEADER_PREFIX, Session, read_clip
+
+WIDTH = 256
+HEIGHT = 64
+HEADER_SIZE = len(HEADER_PREFIX) + 8
+COMMANDS = ["data", "sdat", "zipd", "szip", "sync"]
+ZIPPED = ("zipd", "szip")
+
+# Frames carry their number in the first pixels of the top row, white for a set bit: a fixed marker so
+# other images on the panel are never mistaken for one, then the number
+TAG_MARKER = 0b10110010
+TAG_BITS = 8 + 24
+
+def now_ns():
+    return time.monotonic_ns()
+
+def tag_frame(frame, number):
+    tag = (TAG_MARKER << 24) | (number & 0xffffff)
+    pixels = b"".join(b"\xff\xff\xff\x00" if tag >> (TAG_BITS - 1 - bit) & 1 else b"\x00\x00\x00\x00"
+                      for bit in range(TAG_BITS))
+    return pixels + frame[len(pixels):]
+
+def read_tag(rgb, width):
+    """The frame number tagged into a panel image (RGB, 3 bytes a pixel), or None."""
+    if width < TAG_BITS:
+        return None
+    tag = 0
+    for bit in range(TAG_BITS):
+        tag = (tag << 1) | (1 if rgb[bit * 3] > 127 else 0)
+    return tag & 0xffffff if tag >> 24 == TAG_MARKER else None
+
+def noise_frames(seed=1):
+    rng = random.Random(seed)
+    while True:
+        yield rng.randbytes(FRAME_SIZE)
+
+def gradient_frames():
+    """A diagonal gradient sliding one pixel per frame: compresses well, and changes every pixel."""
+    cycle = b"".join(bytes((x, 255 - x, (x * 2) & 0xff, 0)) for x in range(256)) * 2
+    offset = 0
+    while True:
+        yield b"".join(cycle[(offset + y) % 256 * 4:((offset + y) % 256 + WIDTH) * 4] for y in range(HEIGHT))
+        offset += 1
+
+def clip_frames(filename):
+    frames = list(read_clip(filename))
+    if not frames:
+        raise ValueError(f"{filename} holds no complete {FRAME_SIZE} byte frames")
+    while True:
+        yield from frames
+
+def prepare(command, content, count, level):
+    """Builds every message up front, so generating and compressing frames isn't part of the timing.
+
+    Returns a list of (messages, raw size) per frame, messages being (command, payload) pairs.
+    """
+    frames = []
+    for number, frame in zip(range(count), content):
+        frame = tag_frame(frame, number)
+        if command == "sync":
+            messages = [("sync", b"")]
+        elif command in ZIPPED:
+            messages = [(command, zlib.compress(frame, level))]
+        else:
+            messages = [(command, frame)]
+        if command in ("data", "zipd"):
+            messages.append(("sync", b""))  # Shown like sdat and szip frames are
+        frames.append((messages, 0 if command == "sync" else len(frame)))
+    return frames
+
+class StandIn:
+    """Takes one session on a local port and handles it like the firmware does: checks every header,
+    collects payloads and inflates zipped frames to a full frame. Notes when each frame was done."""
+
+    def __init__(self, command):
+        self.command = command  # The one being benchmarked, its messages are the frames
+        self.listener = socket.create_server(("127.0.0.1", 0))
+        self.port = self.listener.getsockname()[1]
+        self.completed = []     # now_ns() each frame was handled at, in order
+        self.error = None
+        self.thread = threading.Thread(target=self.serve, daemon=True)
+        self.thread.start()
+
+    def serve(self):
+        try:
+            connection, _ = self.listener.accept()
+            with connection:
+                self.receive(connection)
+        except Exception as e:  # Reported by the benchmark, not lost in this thread
+            self.error = e
+
+    def receive(self, connection):
+        pending = bytearray()
+        while True:
+            chunk = connection.recv(256 * 1024)
+            if not chunk:
+                if pending:
+                    raise ValueError(f"{len(pending)} bytes of an incomplete message left over")
+                return
+            pending += chunk
+            while len(pending) >= HEADER_SIZE:
+                if not pending.startswith(HEADER_PREFIX):
+                    raise ValueError("Stream lost sync")
+                size, = struct.unpack("!I", pending[len(HEADER_PREFIX):len(HEADER_PREFIX) + 4])
+                if len(pending) < HEADER_SIZE + size:
+                    break
+                command = pending[HEADER_SIZE - 4:HEADER_SIZE].decode("utf-8")
+                self.handle(command, bytes(pending[HEADER_SIZE:HEADER_SIZE + size]))
+                del pending[:HEADER_SIZE + size]
+
+    def handle(self, command, payload):
+        if command in ZIPPED:
+            payload = zlib.decompress(payload)
+        if command != "sync" and len(payload) != FRAME_SIZE:
+            raise ValueError(f"{command} carried {len(payload)} bytes, not a {FRAME_SIZE} byte frame")
+        if command == self.command:
+            self.completed.append(now_ns())
+
+    def close(self):
+        self.thread.join(timeout=5)
+        self.listener.close()
+        if self.error:
+            raise self.error
+
+class PanelObserver:
+    """Watches the directory the host simulator writes presented frames to (its --frames option, best
+    left empty before it starts) and notes when each tagged frame turns up, to within the millisecond it
+    polls at. The tag is read from the top left of the panel, so the simulator must not rotate."""
+
+    def __init__(self, directory):
+        self.directory = directory
+        numbers = [int(name[6:12]) for name in os.listdir(directory)
+                   if name.startswith("frame_") and name.endswith(".ppm")]
+        self.next = max(numbers, default=-1) + 1  # The simulator numbers the frames it writes in order
+        self.presented = {}     # Frame number -> now_ns() it turned up
+        self.running = True
+        self.thread = threading.Thread(target=self.watch, daemon=True)
+        self.thread.start()
+
+    def watch(self):
+        while self.running:
+            path = os.path.join(self.directory, f"frame_{self.next:06d}.ppm")
+            if not os.path.exists(path):
+                time.sleep(0.001)
+                continue
+            seen = now_ns()
+            self.next += 1
+            number = self.read(path)
+            if number is not None and number not in self.presented:
+                self.presented[number] = seen
+
+    @staticmethod
+    def read(path):
+        with open(path, "rb") as f:
+            data = f.read()
+        # P6, width, height and maximum, each followed by one whitespace byte
+        fields = data.split(maxsplit=4)
+        if len(fields) < 5 or fields[0] != b"P6":
+            return None
+        width = int(fields[1])
+        header = len(b" ".join(fields[:4])) + 1
+        return read_tag(data[header:header + TAG_BITS * 3], width)
+
+    def close(self, settle=0.5):
+        time.sleep(settle)  # The last frames wait for a vblank and then to be written
+        self.running = False
+        self.thread.join()
+
+def percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+def run(command, frames, host, port, fps, warmup, standin=None, observer=None):
+    sent = []           # now_ns() each frame started to be sent
+    send_ns = []        # How long its messages took to be taken by the socket
+    wire_bytes = raw_bytes = 0
+
+    # A board or simulator falling behind holds messages up for as long as its queue takes to drain
+    with Session(host, port, timeout=30.0) as session:
+        started = now_ns()
+        for messages, raw_size in frames:
+            frame_started = now_ns()
+            for name, payload in messages:
+                session.send(name, payload)
+                wire_bytes += HEADER_SIZE + len(payload)
+            sent.append(frame_started)
+            send_ns.append(now_ns() - frame_started)
+            raw_bytes += raw_size
+            if fps:
+                time.sleep(max(0.0, 1.0 / fps - (now_ns() - frame_started) / 1e9))
+    finished = now_ns()
+
+    if standin:
+        standin.close()
+        done = {number: at for number, at in enumerate(standin.completed)}
+        kind = "parsed"
+    elif observer and command != "sync":
+        observer.close()
+        done = observer.presented
+        kind = "photon"
+    else:
+        done = {number: sent[number] + spent for number, spent in enumerate(send_ns)}
+        kind = "send"
+
+    # Up to the last frame seen done where that can be seen, not just into the socket buffers
+    elapsed = max(max(done.values(), default=finished), finished) - started
+    elapsed = max(elapsed / 1e9, 1e-9)
+    payload_bytes = sum(len(payload) for messages, _ in frames for name, payload in messages if name != "sync")
+    ratio = raw_bytes / payload_bytes if payload_bytes else 1.0
+    print(f"⏱️  {command}: {len(frames)} frames in {elapsed:.2f} s, {len(frames) / elapsed:.1f} frames/s, "
+          f"{wire_bytes / elapsed / 1e6:.2f} MB/s on the wire, {raw_bytes / elapsed / 1e6:.2f} MB/s of pixels, "
+          f"ratio {ratio:.2f}x")
+
+    latencies = [(done[number] - sent[number]) / 1e6 for number in range(warmup, len(frames)) if number in done]
+    measured = len(frames) - warmup
+    if not latencies:
+        print(f"    latency ({kind}): no frames to measure")
+        return
+    missing = f", {measured - len(latencies)} of {measured} never presented" if len(latencies) < measured else ""
+    print(f"    latency ({kind}): p50 {percentile(latencies, 0.5):.2f} ms, p99 {percentile(latencies, 0.99):.2f} ms, "
+          f"max {max(latencies):.2f} ms{missing}")
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Throughput and latency benchmark for the wire protocol.",
+                                     formatter_class=argparse.RawDescriptionHelpFormatter, epilog=__doc__)
+    parser.add_argument("--ip", type=str, help="Board or host simulator address")
+    parser.add_argument("--port", type=int, default=54321, help="Its TCP port")
+    parser.add_argument("--standin", action="store_true", help="Run against a stand-in in this process instead")
+    parser.add_argument("--observe", type=str, help="Directory the host simulator writes frames to, for photon latency")
+    parser.add_argument("--command", nargs="+", choices=COMMANDS, default=COMMANDS,
+                        help="Commands to benchmark, one after the other (default all)")
+    parser.add_argument("--content", choices=["noise", "gradient", "clip"], default="gradient")
+    parser.add_argument("--file", type=str, help="Recorded clip (raw frames back to back) for --content clip")
+    parser.add_argument("--count", type=int, default=300, help="Frames per command")
+    parser.add_argument("--warmup", type=int, default=10, help="Leading frames left out of the latency figures")
+    parser.add_argument("--fps", type=float, default=0, help="Frame rate to send at (0 = as fast as possible)")
+    parser.add_argument("--level", type=int, default=6, help="zlib compression level for zipd/szip")
+
+    args = parser.parse_args()
+    if not args.standin and not args.ip:
+        parser.error("--ip is required unless --standin is given")
+    if args.content == "clip" and not args.file:
+        parser.error("--content clip needs --file")
+
+    for command in args.command:
+        content = {"noise": noise_frames, "gradient": gradient_frames,
+                   "clip": lambda: clip_frames(args.file)}[args.content]()
+        frames = prepare(command, content, args.count, args.level)
+        warmup = min(args.warmup, len(frames) - 1)
+
+        if args.standin:
+            standin = StandIn(command)
+            run(command, frames, "127.0.0.1", standin.port, args.fps, warmup, standin=standin)
+        else:
+            observer = PanelObserver(args.observe) if args.observe else None
+            run(command, frames, args.ip, args.port, args.fps, warmup, observer=observer)
+            if observer and observer.running:
+                observer.close(settle=0)
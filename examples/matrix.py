@@ -1,8 +1,10 @@
 import argparse
+import json
 import socket
 import struct
 import zlib
 import sys
+import time
 from PIL import Image
 
 # Constants
@@ -11,30 +13,409 @@ MULTICAST_IP = "239.255.111.111"
 MULTICAST_PORT = 54321
 BUFFER_SIZE = 4096
 DISCOVERY_TIMEOUT = 5.0
+FRAME_SIZE = 256 * 64 * 4  # Must match matrix::BUFFER_SIZE
+UDP_FRAGMENT_SIZE = 1440   # Fits one Ethernet frame and starts every fragment on a whole pixel
+UDP_FORMATS = {"rgbx8888": 0, "rgb888": 1, "rgb565": 2, "index8": 3, "index4": 4}
+USB_VENDOR_ID = 0xCAFE
+USB_PRODUCT_ID = 0xF00D
+USB_FRAMES_ENDPOINT = 0x04  # Bulk OUT of the vendor interface
+STAT_COUNTERS = ["messages", "bad_headers", "bytes", "frames", "frames_dropped", "inflate_failures",
+                 "mem_err", "pbuf_pool_err", "memp_err", "tcp_drop"]  # In perf::Counter order
+STAT_TIMERS = ["header", "reassembly", "inflate", "convert", "acquire"]
+TRACE_EVENTS = ["CONNECT", "DISCONNECT", "TCP_ERROR", "REFUSED", "HEADER", "BAD_HEADER", "MESSAGE", "FRAME_BUSY",
+                "FRAME_CUT", "TOO_LARGE", "UDP_FRAME", "UDP_DROPPED", "USB_ABANDON", "INFLATE", "COMMIT", "FLIP",
+                "ACQUIRE", "CLOCK_SAMPLE", "DELTA_REFUSED"]  # In trace::Event order
+TRACE_COMMAND_EVENTS = {"HEADER", "BAD_HEADER", "MESSAGE", "FRAME_BUSY", "FRAME_CUT", "TOO_LARGE",
+                        "DELTA_REFUSED"}  # a is a command
+
+def pack_message(command, data=b""):
+    if len(command) != 4:
+        raise ValueError("Command must be exactly 4 characters long.")
+    return HEADER_PREFIX + struct.pack("!I", len(data)) + command.encode("utf-8") + data
+
+class Session:
+    """One TCP connection carrying any number of back to back messages.
+
+    Several sessions can be connected at once (up to `max_conn`, 4 by default), but one at a time owns
+    the canvas: frames arriving on others while it streams one in are dropped. Each session holds a
+    connection slot, so keep them for streaming and close them when done.
+    """
+
+    def __init__(self, host, port, timeout=5.0):
+        self.sock = socket.create_connection((host, port), timeout=timeout)
+        self.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+
+    def send(self, command, data=b""):
+        self.sock.sendall(pack_message(command, data))
+
+    def replies(self):
+        """Text the board sent back so far, without waiting for more."""
+        timeout = self.sock.gettimeout()
+        self.sock.setblocking(False)
+        try:
+            return self.sock.recv(BUFFER_SIZE).decode("utf-8", "replace")
+        except BlockingIOError:
+            return ""
+        finally:
+            self.sock.settimeout(timeout)
+
+    def close(self):
+        try:
+            self.sock.shutdown(socket.SHUT_WR)
+        except OSError:
+            pass
+        self.sock.close()
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc):
+        self.close()
 
 def send_tcp_command(command, data=b"", host=None, port=None):
     if not host or not port:
         print("Error: IP and port are required for TCP commands.")
         return
 
-    file_size = len(data)
-
     if len(command) != 4:
         print("Error: Command must be exactly 4 characters long.")
         return
 
     try:
-        with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
-            s.connect((host, port))
-            header = HEADER_PREFIX + struct.pack("!I", file_size) + command.encode("utf-8")
-            s.sendall(header)
-            if file_size > 0:
-                s.sendall(data)
+        with Session(host, port) as session:
+            session.send(command, data)
             print(f"✅ Command '{command}' sent successfully to {host}:{port}")
-            s.shutdown(socket.SHUT_WR)
     except socket.error as e:
         print(f"❌ Socket error: {e}")
 
+def send_rect(command, x, y, width, height, data, host=None, port=None):
+    expected = width * height * 4
+    if len(data) != expected:
+        print(f"Error: Region {width}x{height} needs {expected} bytes of RGBx data, got {len(data)}.")
+        return
+
+    region = struct.pack("!HHHH", x, y, width, height)
+    send_tcp_command(command, region + data, host, port)
+
+def send_overlay_text(text, x, y, colour, background, scale, host=None, port=None):
+    """Draws text on the overlay, which stays over the frames streamed underneath it. Colours are 0xAARRGGBB,
+    an alpha of 0 leaves the frame showing; a background with any alpha fills the box behind the text."""
+    fields = struct.pack("!hhIIB", x, y, colour, background, scale)
+    send_tcp_command("ovtx", fields + text.encode("ascii", "replace"), host, port)
+
+def clear_overlay(x=None, y=None, width=None, height=None, host=None, port=None):
+    """Clears a region of the overlay, or all of it without one."""
+    region = struct.pack("!HHHH", x, y, width, height) if width and height else b""
+    send_tcp_command("ovcl", region, host, port)
+
+def read_stats(host, port, binary=False):
+    """Asks a board for its perf counters (stat, or stbn for the binary layout) and returns them as a dict,
+    timers as {"count", "cycles", "max"}. Cycles count at clock_hz."""
+    with Session(host, port) as session:
+        session.send("stbn" if binary else "stat")
+        response = b""
+        while True:
+            chunk = session.sock.recv(BUFFER_SIZE)
+            if not chunk:
+                raise ConnectionError("Connection closed before the stats arrived")
+            response += chunk
+            if binary and len(response) >= 12:
+                counters, timers = response[5], response[6]
+                if len(response) >= 12 + 4 * counters + 16 * timers:
+                    break
+            elif not binary and response.endswith(b"}"):
+                try:
+                    return json.loads(response)
+                except ValueError:
+                    pass  # A nested object ended, not the whole one
+
+    if response[:4] != b"mvst":
+        raise ValueError("Not a stats response")
+    stats = {"clock_hz": struct.unpack_from("!I", response, 8)[0]}
+    offset = 12
+    for i in range(counters):
+        stats[STAT_COUNTERS[i] if i < len(STAT_COUNTERS) else f"counter_{i}"] = struct.unpack_from("!I", response, offset)[0]
+        offset += 4
+    for i in range(timers):
+        count, maximum, cycles = struct.unpack_from("!IIQ", response, offset)
+        stats[STAT_TIMERS[i] if i < len(STAT_TIMERS) else f"timer_{i}"] = {"count": count, "cycles": cycles, "max": maximum}
+        offset += 16
+    return stats
+
+def print_stats(stats):
+    clock_hz = stats["clock_hz"]
+    for name, value in stats.items():
+        if isinstance(value, dict):
+            average = value["cycles"] / value["count"] if value["count"] else 0
+            print(f"  {name}: {value['count']} times, average {average * 1e6 / clock_hz:.1f} us, "
+                  f"max {value['max'] * 1e6 / clock_hz:.1f} us")
+        elif name != "clock_hz":
+            print(f"  {name}: {value}")
+
+def read_trace(host, port):
+    """Dumps a board's trace ring (trce). Returns (time_us of the dump, entries oldest first), each entry a
+    (time_us, sequence, event name, core, a, b) tuple."""
+    with Session(host, port) as session:
+        session.send("trce")
+        response = b""
+        while len(response) < 16 or len(response) < 16 + struct.unpack_from("!I", response, 8)[0] * response[5]:
+            chunk = session.sock.recv(BUFFER_SIZE)
+            if not chunk:
+                raise ConnectionError("Connection closed before the trace arrived")
+            response += chunk
+
+    if response[:4] != b"mvtl":
+        raise ValueError("Not a trace dump")
+    entry_size = response[5]
+    count, now = struct.unpack_from("!II", response, 8)
+    entries = []
+    for i in range(count):
+        time_us, sequence, event, core, a, b = struct.unpack_from("!IHBBII", response, 16 + i * entry_size)
+        name = TRACE_EVENTS[event] if event < len(TRACE_EVENTS) else f"EVENT_{event}"
+        entries.append((time_us, sequence, name, core, a, b))
+    return now, entries
+
+def print_trace(now, entries):
+    previous = None
+    for time_us, sequence, name, core, a, b in entries:
+        ago = (now - time_us) & 0xffffffff
+        step = (time_us - previous) & 0xffffffff if previous is not None else 0
+        previous = time_us
+        if name in TRACE_COMMAND_EVENTS:
+            a = struct.pack("!I", a).decode("latin-1")
+        print(f"  {-ago / 1000:10.3f} ms  +{step:6d} us  core {core}  {name:<12} {a} {b}")
+
+def pack_rgb888(data):
+    """Drops the padding byte of each 4 byte B G R x pixel."""
+    pixels = len(data) // 4
+    packed = bytearray(pixels * 3)
+    packed[0::3] = data[0::4]
+    packed[1::3] = data[1::4]
+    packed[2::3] = data[2::4]
+    return bytes(packed)
+
+def pack_rgb565(data):
+    """Packs 4 byte B G R x pixels into little endian RGB565."""
+    pixels = len(data) // 4
+    packed = bytearray(pixels * 2)
+    for i in range(pixels):
+        b, g, r = data[i * 4], data[i * 4 + 1], data[i * 4 + 2]
+        value = ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+        packed[i * 2] = value & 0xff
+        packed[i * 2 + 1] = value >> 8
+    return bytes(packed)
+
+def index_frame(data, bits=8):
+    """Splits a raw B G R x frame into (palette, index frame) for the idx8/idx4 commands.
+
+    Fails if the frame holds more colours than the index width can address.
+    """
+    colours = {}
+    indices = bytearray(len(data) // 4)
+    for i in range(len(indices)):
+        colour = bytes(data[i * 4:i * 4 + 3]) + b"\x00"
+        indices[i] = colours.setdefault(colour, len(colours))
+
+    if len(colours) > (1 << bits):
+        raise ValueError(f"Frame has {len(colours)} colours, {bits} bit indices address {1 << bits}")
+
+    palette = b"".join(colours) + bytes(4 * (256 - len(colours)))
+    if bits == 4:
+        indices = bytes((indices[i] << 4) | indices[i + 1] for i in range(0, len(indices), 2))
+    return palette, bytes(indices)
+
+def calibration_curves(gamma=2.2, white=(1.0, 1.0, 1.0)):
+    """Builds the per-channel curves for clut: 8 bit input to 10 bit panel level, red, green, blue.
+
+    white scales each channel's full level, e.g. (1.0, 0.92, 0.85) tames a blueish white point.
+    """
+    levels = []
+    for gain in white:
+        levels += [min(1023, round(1023 * gain * (v / 255) ** gamma)) for v in range(256)]
+    return struct.pack("<768H", *levels)
+
+def xor_bytes(a, b):
+    # Big integer XOR runs in C, so this stays fast without numpy
+    return (int.from_bytes(a, "little") ^ int.from_bytes(b, "little")).to_bytes(len(a), "little")
+
+class DeltaEncoder:
+    """Encodes frames as zlib compressed XOR deltas against the previous frame.
+
+    The display XORs a delta (xzip/sxzp) onto whatever it currently holds, so every frame after a
+    keyframe (zipd/szip) depends on the display having received all frames before it. After a frame
+    fails to inflate the display refuses deltas ("Delta refused, send a keyframe") until the next
+    keyframe; call restart() when that reply comes back.
+    """
+
+    def __init__(self, keyframe_interval=0, level=6):
+        self.keyframe_interval = keyframe_interval
+        self.level = level
+        self.previous = None
+        self.since_keyframe = 0
+
+    def encode(self, frame, show=True):
+        """Returns (command, payload) for the next frame."""
+        keyframe = (self.previous is None or
+                    (self.keyframe_interval and self.since_keyframe >= self.keyframe_interval))
+
+        if keyframe:
+            command = "szip" if show else "zipd"
+            payload = zlib.compress(frame, self.level)
+            self.since_keyframe = 0
+        else:
+            command = "sxzp" if show else "xzip"
+            payload = zlib.compress(xor_bytes(frame, self.previous), self.level)
+            self.since_keyframe += 1
+
+        self.previous = frame
+        return command, payload
+
+    def restart(self):
+        """Makes the next frame a keyframe."""
+        self.previous = None
+
+def read_clip(filename, frame_size=FRAME_SIZE):
+    """Yields the frames of a recorded clip: raw frames of frame_size bytes back to back."""
+    with open(filename, "rb") as f:
+        while True:
+            frame = f.read(frame_size)
+            if len(frame) < frame_size:
+                return
+            yield frame
+
+def send_clip(filename, show, keyframe_interval, fps, host, port):
+    encoder = DeltaEncoder(keyframe_interval)
+    try:
+        with Session(host, port) as session:
+            frames = 0
+            sent = 0
+            for frame in read_clip(filename):
+                started = time.monotonic()
+                if "keyframe" in session.replies():
+                    encoder.restart()
+                command, payload = encoder.encode(frame, show)
+                session.send(command, payload)
+                if not show:
+                    session.send("sync")
+                frames += 1
+                sent += len(payload)
+                if fps:
+                    time.sleep(max(0.0, 1.0 / fps - (time.monotonic() - started)))
+            print(f"✅ Sent {frames} frames ({sent} payload bytes) to {host}:{port}")
+    except socket.error as e:
+        print(f"❌ Socket error: {e}")
+
+def benchmark_clip(filename, keyframe_interval, level):
+    """Compares wire size and encode time of zipd (every frame independent) against XOR deltas."""
+    encoder = DeltaEncoder(keyframe_interval, level)
+    frames = 0
+    raw_bytes = zipd_bytes = delta_bytes = 0
+    zipd_time = delta_time = 0.0
+
+    for frame in read_clip(filename):
+        started = time.perf_counter()
+        zipd_bytes += len(zlib.compress(frame, level))
+        zipd_time += time.perf_counter() - started
+
+        started = time.perf_counter()
+        delta_bytes += len(encoder.encode(frame)[1])
+        delta_time += time.perf_counter() - started
+
+        raw_bytes += len(frame)
+        frames += 1
+
+    if frames == 0:
+        print(f"Error: {filename} holds no complete {FRAME_SIZE} byte frames.")
+        return
+
+    print(f"{frames} frames, {raw_bytes} raw bytes")
+    for name, size, elapsed in (("zipd", zipd_bytes, zipd_time), ("xzip", delta_bytes, delta_time)):
+        print(f"  {name}: {size:>10} bytes  {size / frames:>9.0f} bytes/frame  "
+              f"ratio {raw_bytes / max(size, 1):6.1f}x  encode {elapsed / frames * 1000:6.2f} ms/frame")
+
+def host_time_us():
+    """The clock boards sync to: monotonic, and the same for every process on this machine."""
+    return time.monotonic_ns() // 1000
+
+def sync_clocks(host, port, rounds, interval):
+    """Runs NTP style exchanges with every board that answers, so they can present at host clock times.
+
+    Requests go to the multicast group (or --ip), every reply is answered with all four timestamps so
+    the board works out its own offset. Boards drift by tens of microseconds per second, so keep
+    syncing every few seconds while presenting.
+    """
+    address = (host or MULTICAST_IP, port or MULTICAST_PORT)
+    boards = {}
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 2)
+        sock.settimeout(0.05)
+        for sequence in range(rounds):
+            sock.sendto(b"mvtq" + struct.pack("!IQ", sequence, host_time_us()), address)
+            window_end = time.monotonic() + interval
+            while time.monotonic() < window_end:
+                try:
+                    reply, board = sock.recvfrom(64)
+                except socket.timeout:
+                    continue
+                t4 = host_time_us()
+                if len(reply) < 32 or reply[:4] != b"mvtr":
+                    continue
+                reply_sequence, t1, t2, t3 = struct.unpack("!IQQQ", reply[4:32])
+                if reply_sequence != sequence:
+                    continue
+                # Unicast: the timestamps in the reply are only meaningful to the board that sent them
+                sock.sendto(b"mvtf" + reply[4:32] + struct.pack("!Q", t4), board)
+                delay = (t4 - t1) - (t3 - t2)
+                if board[0] not in boards or delay < boards[board[0]][1]:
+                    boards[board[0]] = (((t2 - t1) + (t3 - t4)) // 2, delay)
+
+    for ip, (offset, delay) in sorted(boards.items()):
+        print(f"🕒 {ip}: offset {offset} us, best round trip {delay} us")
+    if not boards:
+        print("❌ No board answered")
+
+def send_timed_sync(delay_ms):
+    """Multicasts a sync that every board presents at the same host clock time."""
+    present_at = host_time_us() + int(delay_ms * 1000)
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 2)
+        sock.sendto(b"mvps" + struct.pack("!Q", present_at), (MULTICAST_IP, MULTICAST_PORT))
+    print(f"📡 Timed sync for {delay_ms} ms from now sent to {MULTICAST_IP}:{MULTICAST_PORT}")
+
+def send_udp_frame(sock, address, frame_id, data, pixel_format=0, show=True, canvas=None, present_at=None):
+    """Sends one frame as "mvfr" fragments. Lost fragments drop the frame, they are never resent.
+
+    With canvas=(width, height) the frame is a canvas spanning several panels, each panel shows the
+    region at its canvas_x/canvas_y setting (panels side by side in `order` by default).
+    With present_at (see host_time_us) synced boards show the frame at that time instead of on arrival.
+    """
+    count = (len(data) + UDP_FRAGMENT_SIZE - 1) // UDP_FRAGMENT_SIZE
+    flags = (1 if show else 0) | (2 if canvas else 0) | (4 if present_at is not None else 0)
+    extension = struct.pack("!HH", *canvas) if canvas else b""
+    if present_at is not None:
+        extension += struct.pack("!Q", present_at)
+    for index in range(count):
+        offset = index * UDP_FRAGMENT_SIZE
+        header = b"mvfr" + struct.pack("!IIIHHBBxx", frame_id & 0xffffffff, offset, len(data), index, count,
+                                       flags, pixel_format) + extension
+        sock.sendto(header + data[offset:offset + UDP_FRAGMENT_SIZE], address)
+
+def send_udp_clip(filename, host, port, fps, pixel_format, canvas=None, present_delay_ms=0):
+    pack = {1: pack_rgb888, 2: pack_rgb565}.get(pixel_format, lambda data: data)
+    address = (host or MULTICAST_IP, port or MULTICAST_PORT)
+    frame_size = canvas[0] * canvas[1] * 4 if canvas else FRAME_SIZE
+    with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
+        sock.setsockopt(socket.IPPROTO_IP, socket.IP_MULTICAST_TTL, 2)
+        frames = 0
+        for frame_id, frame in enumerate(read_clip(filename, frame_size)):
+            started = time.monotonic()
+            present_at = host_time_us() + int(present_delay_ms * 1000) if present_delay_ms else None
+            send_udp_frame(sock, address, frame_id, pack(frame), pixel_format, canvas=canvas, present_at=present_at)
+            frames += 1
+            if fps:
+                time.sleep(max(0.0, 1.0 / fps - (time.monotonic() - started)))
+        print(f"📡 Sent {frames} frames over UDP to {address[0]}:{address[1]}")
+
 def send_multicast_message(command):
     try:
         with socket.socket(socket.AF_INET, socket.SOCK_DGRAM) as sock:
@@ -44,6 +425,44 @@ def send_multicast_message(command):
     except socket.error as e:
         print(f"❌ Multicast socket error: {e}")
 
+class UsbLink:
+    """The vendor bulk interface of a board on USB. Takes the same commands as the CDC port: the prefix
+    and the command followed by a payload of the length the command implies, with no size field.
+
+    Needs pyusb (and so libusb). The firmware side of the link is tested without a board by the host
+    build's usb_test.
+    """
+
+    def __init__(self, timeout_ms=2000):
+        import usb.core
+        self.device = usb.core.find(idVendor=USB_VENDOR_ID, idProduct=USB_PRODUCT_ID)
+        if self.device is None:
+            raise OSError("No board found on USB")
+        self.timeout_ms = timeout_ms
+
+    def send(self, command, data=b""):
+        self.device.write(USB_FRAMES_ENDPOINT, HEADER_PREFIX + command.encode("utf-8") + data, self.timeout_ms)
+
+    def close(self):
+        import usb.util
+        usb.util.dispose_resources(self.device)
+
+def send_usb_clip(filename, fps):
+    # USB frames are always shown on arrival, `data` is the full RGBX8888 frame command there
+    link = UsbLink()
+    frames = 0
+    started = time.monotonic()
+    for frame in read_clip(filename):
+        frame_started = time.monotonic()
+        link.send("data", frame)
+        frames += 1
+        if fps:
+            time.sleep(max(0.0, 1.0 / fps - (time.monotonic() - frame_started)))
+    link.close()
+    elapsed = max(time.monotonic() - started, 1e-9)
+    print(f"🔌 Sent {frames} frames over USB: {frames / elapsed:.1f} fps, "
+          f"{frames * FRAME_SIZE / elapsed / 1e6:.2f} MB/s")
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(
         description="Client script for sending commands to LED displays.",
@@ -55,10 +474,29 @@ if __name__ == "__main__":
                                   "  - FACT (Factory Reset, TCP)\n"
                                   "  - text <string> (Send plain text, TCP)\n"
                                   "  - RSET, BOOT, ipv4, ipv6, stor, clsc (TCP commands)\n"
+                                  "  - stat [--binary] (Read the performance counters, TCP)\n"
+                                  "  - trce (Dump the trace of recent events, TCP)\n"
                                   "  - sync, dscv (Multicast commands)\n"
+                                  "  - clock [--ip] [--rounds] [--interval] (Sync board clocks to this host)\n"
+                                  "  - tsync --delay <ms> (Multicast a sync presented at the same instant on every synced board)\n"
                                   "  - kget <key>, kdel <key>, kset <key> <value> (TCP key-value commands)\n"
                                   "  - data <filename>, sdat <filename> (Send raw image file over TCP)\n"
-                                  "  - zipd <filename>, szip <filename> (Send compressed image file over TCP)"
+                                  "  - zipd <filename>, szip <filename> (Send compressed image file over TCP)\n"
+                                  "  - d888, s888 <filename> (Send a raw image file packed as RGB888 over TCP)\n"
+                                  "  - d565, s565 <filename> (Send a raw image file packed as RGB565 over TCP)\n"
+                                  "  - idx8, sid8, idx4, sid4 <filename> (Send a raw image file as palette + indices over TCP)\n"
+                                  "  - zix8, szx8, zix4, szx4 <filename> (Same, with compressed indices)\n"
+                                  "  - clut [--gamma] [--white r,g,b] [--reset] (Upload per-channel colour calibration, TCP)\n"
+                                  "  - rect, srct --file <filename> --x --y --width --height (Update a region over TCP)\n"
+                                  "  - ovtx --text <string> [--x] [--y] [--colour] [--background] [--scale] (Draw text on the\n"
+                                  "    overlay over the frames, TCP)\n"
+                                  "  - ovcl [--x --y --width --height] (Clear a region of the overlay, or all of it, TCP)\n"
+                                  "  - xzip, sxzp --file <clip> (Stream a recorded clip as XOR delta frames over TCP)\n"
+                                  "  - udp --file <clip> [--ip] [--format] (Stream a recorded clip as UDP frames, multicast without --ip)\n"
+                                  "  - canvas --file <clip> --width --height [--format] (Multicast a clip of canvas-sized frames,\n"
+                                  "    every panel shows its own region of it)\n"
+                                  "  - usb --file <clip> [--fps] (Stream a recorded clip over the USB vendor interface)\n"
+                                  "  - bench --file <clip> (Compare zipd and XOR delta sizes for a recorded clip)"
     )
 
     parser.add_argument("--ip", type=str, help="Target IP address (Required for TCP commands)")
@@ -68,17 +506,42 @@ if __name__ == "__main__":
     parser.add_argument("--text", type=str, help="Text to send for 'text' command")
     parser.add_argument("--file", type=str, help="Filename for data transfer")
     parser.add_argument("--compress", action="store_true", help="Compress file before sending")
+    parser.add_argument("--x", type=int, default=0, help="Region left edge for rect/srct")
+    parser.add_argument("--y", type=int, default=0, help="Region top edge for rect/srct")
+    parser.add_argument("--width", type=int, help="Region width for rect/srct, canvas width for canvas")
+    parser.add_argument("--height", type=int, help="Region height for rect/srct, canvas height for canvas")
+    parser.add_argument("--keyframe-interval", type=int, default=0,
+                        help="Send a full frame every N delta frames (0 = only the first)")
+    parser.add_argument("--fps", type=float, default=0, help="Frame rate for xzip/sxzp (0 = as fast as possible)")
+    parser.add_argument("--level", type=int, default=6, help="zlib compression level for bench")
+    parser.add_argument("--format", choices=["rgbx8888", "rgb888", "rgb565"], default="rgbx8888",
+                        help="Pixel format for udp")
+    parser.add_argument("--gamma", type=float, default=2.2, help="Gamma of the clut curves")
+    parser.add_argument("--white", type=str, default="1,1,1", help="Red, green, blue gains of the clut curves")
+    parser.add_argument("--reset", action="store_true", help="Go back to the built in gamma curve for clut")
+    parser.add_argument("--rounds", type=int, default=8, help="Clock exchanges for clock")
+    parser.add_argument("--interval", type=float, default=0.25, help="Seconds between clock exchanges")
+    parser.add_argument("--delay", type=float, default=50, help="Milliseconds ahead to present a tsync at")
+    parser.add_argument("--present-delay", type=float, default=0,
+                        help="Present udp/canvas frames this many ms after sending (0 = on arrival)")
+    parser.add_argument("--binary", action="store_true", help="Fetch stat in the binary layout rather than as JSON")
+    parser.add_argument("--colour", type=lambda v: int(v, 16), default=0xffffffff,
+                        help="Text colour for ovtx as hex AARRGGBB (default opaque white)")
+    parser.add_argument("--background", type=lambda v: int(v, 16), default=0,
+                        help="Box behind the ovtx text as hex AARRGGBB (default none)")
+    parser.add_argument("--scale", type=int, default=1, help="Text size for ovtx, 1 to 4")
 
     args = parser.parse_args()
 
-    tcp_commands = ["FACT", "text", "RSET", "BOOT", "ipv4", "ipv6", "stor", "clsc", "kget", "kdel", "kset", "data", "sdat", "zipd", "szip"]
+    tcp_commands = ["FACT", "text", "RSET", "BOOT", "ipv4", "ipv6", "stor", "clsc", "stat", "trce", "kget", "kdel", "kset", "ovtx", "ovcl", "data", "sdat", "zipd", "szip", "rect", "srct", "xzip", "sxzp", "d888", "s888", "d565", "s565",
+                    "idx8", "sid8", "idx4", "sid4", "zix8", "szx8", "zix4", "szx4"]
 
     if args.command in tcp_commands and (not args.ip or not args.port):
         print("❌ Error: TCP commands require --ip and --port arguments.")
         sys.exit(1)
 
     if args.command == "FACT":
-        send_tcp_command("FACT", host=args.ip, port=args.port)
+        send_tcp_command("FACR", host=args.ip, port=args.port)
 
     elif args.command == "text" and args.text:
         send_tcp_command("text", args.text.encode(), args.ip, args.port)
@@ -86,9 +549,21 @@ if __name__ == "__main__":
     elif args.command in ["RSET", "BOOT", "ipv4", "ipv6", "stor", "clsc"]:
         send_tcp_command(args.command, host=args.ip, port=args.port)
 
+    elif args.command == "stat":
+        print_stats(read_stats(args.ip, args.port, args.binary))
+
+    elif args.command == "trce":
+        print_trace(*read_trace(args.ip, args.port))
+
     elif args.command == "sync":
         send_multicast_message(args.command)
 
+    elif args.command == "clock":
+        sync_clocks(args.ip, args.port, args.rounds, args.interval)
+
+    elif args.command == "tsync":
+        send_timed_sync(args.delay)
+
     elif args.command == "dscv":
         send_multicast_message("dscv")
 
@@ -101,5 +576,56 @@ if __name__ == "__main__":
     elif args.command == "kset" and args.key and args.value:
         send_tcp_command("kset", f"{args.key}:{args.value}".encode(), args.ip, args.port)
 
+    elif args.command in ["rect", "srct"] and args.file and args.width and args.height:
+        with open(args.file, "rb") as f:
+            send_rect(args.command, args.x, args.y, args.width, args.height, f.read(), args.ip, args.port)
+
+    elif args.command == "ovtx" and args.text:
+        send_overlay_text(args.text, args.x, args.y, args.colour, args.background, args.scale, args.ip, args.port)
+
+    elif args.command == "ovcl":
+        clear_overlay(args.x, args.y, args.width, args.height, args.ip, args.port)
+
+    elif args.command in ["d888", "s888"] and args.file:
+        with open(args.file, "rb") as f:
+            send_tcp_command(args.command, pack_rgb888(f.read()), args.ip, args.port)
+
+    elif args.command in ["d565", "s565"] and args.file:
+        with open(args.file, "rb") as f:
+            send_tcp_command(args.command, pack_rgb565(f.read()), args.ip, args.port)
+
+    elif args.command in ["idx8", "sid8", "idx4", "sid4", "zix8", "szx8", "zix4", "szx4"] and args.file:
+        with open(args.file, "rb") as f:
+            palette, indices = index_frame(f.read(), 4 if args.command.endswith("4") else 8)
+        if args.command.startswith(("z", "sz")):
+            indices = zlib.compress(indices)
+        with Session(args.ip, args.port) as session:
+            session.send("pltt", palette)
+            session.send(args.command, indices)
+
+    elif args.command == "clut":
+        if args.reset:
+            send_tcp_command("clut", b"", args.ip, args.port)
+        else:
+            white = tuple(float(v) for v in args.white.split(","))
+            send_tcp_command("clut", calibration_curves(args.gamma, white), args.ip, args.port)
+
+    elif args.command in ["xzip", "sxzp"] and args.file:
+        send_clip(args.file, args.command == "sxzp", args.keyframe_interval, args.fps, args.ip, args.port)
+
+    elif args.command == "udp" and args.file:
+        send_udp_clip(args.file, args.ip, args.port, args.fps, UDP_FORMATS[args.format],
+                      present_delay_ms=args.present_delay)
+
+    elif args.command == "canvas" and args.file and args.width and args.height:
+        send_udp_clip(args.file, None, args.port, args.fps, UDP_FORMATS[args.format], (args.width, args.height),
+                      args.present_delay)
+
+    elif args.command == "usb" and args.file:
+        send_usb_clip(args.file, args.fps)
+
+    elif args.command == "bench" and args.file:
+        benchmark_clip(args.file, args.keyframe_interval, args.level)
+
     else:
         parser.print_help()
\ No newline at end of file
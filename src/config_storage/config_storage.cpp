@@ -1,6 +1,7 @@
 #include "config_storage.hpp"
 #include "hardware/flash.h"
 #include "hardware/sync.h"
+#include "pico/flash.h"
 #include "buildinfo.h"
 #include <cstring>
 #include <vector>
@@ -42,23 +43,86 @@ void KVStore::loadFromFlash() {
     }
 }
 
+struct flash_write_t {
+    uint32_t offset;
+    const uint8_t* data;
+    size_t length;
+};
+
+// Runs with interrupts disabled and the other core parked, see flash_safe_execute
+static void write_sector(void* param) {
+    auto* write = static_cast<const flash_write_t*>(param);
+    flash_range_erase(write->offset, FLASH_SECTOR_SIZE);
+    if (write->length > 0) {
+        flash_range_program(write->offset, write->data, write->length);
+    }
+}
+
 // Commit to flash only if changes are made
 bool KVStore::commitToFlash() {
     if (!hasChanged) return false;
 
-    uint32_t ints = save_and_disable_interrupts();
     kv_store.crc32 = 0;
     kv_store.crc32 = calculateCRC32((uint8_t*)&kv_store, sizeof(kv_store_t));
 
-    flash_range_erase(FLASH_STORAGE_BASE, FLASH_SECTOR_SIZE);
-    flash_range_program(FLASH_STORAGE_BASE, (const uint8_t*)&kv_store, sizeof(kv_store_t));
+    // Core 1 executes from flash too, so it has to be locked out while the sector is rewritten
+    flash_write_t write = {FLASH_STORAGE_BASE, (const uint8_t*)&kv_store, sizeof(kv_store_t)};
+    if (flash_safe_execute(write_sector, &write, 1000) != PICO_OK) {
+        return false;
+    }
 
-    restore_interrupts(ints);
     hasChanged = false;
 
     return true;
 }
 
+#define CALIBRATION_VALID_FLAG 0xCA11B8A7
+
+struct calibration_header_t {
+    uint32_t valid_flag;
+    uint32_t length;
+    uint32_t crc32;
+};
+
+bool KVStore::loadCalibration(uint8_t* data, size_t length) {
+    const uint8_t* flash_mem = (const uint8_t*)(XIP_BASE + FLASH_CALIBRATION_BASE);
+    calibration_header_t header;
+    std::memcpy(&header, flash_mem, sizeof(header));
+
+    if (header.valid_flag != CALIBRATION_VALID_FLAG || header.length != length ||
+        length > FLASH_SECTOR_SIZE - sizeof(header)) {
+        return false;
+    }
+    if (calculateCRC32(flash_mem + sizeof(header), length) != header.crc32) {
+        return false;
+    }
+
+    std::memcpy(data, flash_mem + sizeof(header), length);
+    return true;
+}
+
+bool KVStore::storeCalibration(const uint8_t* data, size_t length) {
+    if (length > FLASH_SECTOR_SIZE - sizeof(calibration_header_t)) {
+        return false;
+    }
+
+    // ✅ Spare the flash an erase cycle when the same tables are uploaded again
+    const uint8_t* stored = (const uint8_t*)(XIP_BASE + FLASH_CALIBRATION_BASE);
+    calibration_header_t header = {CALIBRATION_VALID_FLAG, static_cast<uint32_t>(length), calculateCRC32(data, length)};
+    if (length > 0 && std::memcmp(stored, &header, sizeof(header)) == 0 &&
+        std::memcmp(stored + sizeof(header), data, length) == 0) {
+        return true;
+    }
+
+    // ✅ Programmed in whole pages, the padding stays erased
+    std::vector<uint8_t> sector((sizeof(header) + length + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE, 0xff);
+    std::memcpy(sector.data(), &header, sizeof(header));
+    std::memcpy(sector.data() + sizeof(header), data, length);
+
+    flash_write_t write = {FLASH_CALIBRATION_BASE, sector.data(), length > 0 ? sector.size() : 0};
+    return flash_safe_execute(write_sector, &write, 1000) == PICO_OK;
+}
+
 void KVStore::setFactoryDefaults() {
     // ✅ Reset key-value store structure
     std::memset(&kv_store, 0, sizeof(kv_store_t));
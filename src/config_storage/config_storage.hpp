@@ -9,6 +9,7 @@
 #define FLASH_SECTOR_SIZE    4096
 #define FLASH_KV_STORE_SIZE  FLASH_SECTOR_SIZE
 #define FLASH_STORAGE_BASE   (PICO_FLASH_SIZE_BYTES - FLASH_KV_STORE_SIZE)
+#define FLASH_CALIBRATION_BASE (FLASH_STORAGE_BASE - FLASH_SECTOR_SIZE)  // Colour calibration, too big for an entry
 
 #define MAX_KEY_LEN    16
 #define MAX_VALUE_LEN  128
@@ -26,7 +27,8 @@ inline const std::unordered_map<std::string, std::string> factory_defaults = {
     {"order", "1"},
     {"wifi_auth", "16777220"},
     {"color_order", "BGR"},
-    {"brightness", "255"}
+    {"brightness", "255"},
+    {"max_conn", "4"}
 };
 
 class KVStore {
@@ -49,6 +51,10 @@ public:
     bool commitToFlash();
     void loadFromFlash();
 
+    // Colour calibration tables are kept in a sector of their own and written straight away
+    bool loadCalibration(uint8_t* data, size_t length);
+    bool storeCalibration(const uint8_t* data, size_t length);  // Length 0 erases them
+
 private:
     struct kv_pair_t {
         uint8_t key[MAX_KEY_LEN];
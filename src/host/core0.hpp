@@ -0,0 +1,13 @@
+#ifndef HOST_CORE0_HPP
+#define HOST_CORE0_HPP
+
+#include <mutex>
+
+// Taken for whatever would run with core 0's interrupts off on the device: lwIP callbacks, code between
+// cyw43_arch_lwip_begin/end and between save_and_disable_interrupts/restore_interrupts
+std::recursive_mutex& core0_lock();
+
+// What get_core_num() answers on the calling thread, for threads standing in for a core's interrupts
+void set_core_num(unsigned int core);
+
+#endif // HOST_CORE0_HPP
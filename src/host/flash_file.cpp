@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include "host.hpp"
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+// The whole flash lives in memory, reads go straight to it as reads of XIP do on the device.
+// Erases and writes update it and the same range of the file, so settings survive a restart.
+static std::vector<uint8_t> image(PICO_FLASH_SIZE_BYTES, 0xff);
+static int flash_fd = -1;
+
+bool host::open_flash(const std::string &path) {
+    flash_fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (flash_fd < 0) {
+        std::perror(path.c_str());
+        return false;
+    }
+
+    // ✅ A new or short file reads as erased flash past its end
+    ssize_t length = pread(flash_fd, image.data(), image.size(), 0);
+    if (length < static_cast<ssize_t>(image.size())) {
+        std::fill(image.begin() + std::max<ssize_t>(length, 0), image.end(), 0xff);
+    }
+    return true;
+}
+
+const uint8_t* host_flash_image() {
+    return image.data();
+}
+
+static void write_through(uint32_t offset, size_t count) {
+    if (flash_fd >= 0 && pwrite(flash_fd, image.data() + offset, count, offset) != static_cast<ssize_t>(count)) {
+        std::perror("flash file");
+    }
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count) {
+    std::fill_n(image.begin() + flash_offs, count, 0xff);
+    write_through(flash_offs, count);
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count) {
+    // ✅ Programming can only clear bits, like NOR flash
+    for (size_t i = 0; i < count; i++) {
+        image[flash_offs + i] &= data[i];
+    }
+    write_through(flash_offs, count);
+}
@@ -0,0 +1,6 @@
+#ifndef HOST_BSP_BOARD_H
+#define HOST_BSP_BOARD_H
+
+// TinyUSB's board support, nothing of it is used on the host
+
+#endif // HOST_BSP_BOARD_H
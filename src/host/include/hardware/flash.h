@@ -0,0 +1,11 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+// Offsets are from the start of flash, as on the device; changes are written through to the flash file
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t* data, size_t count);
+
+#endif // HOST_HARDWARE_FLASH_H
@@ -0,0 +1,10 @@
+#ifndef HOST_HARDWARE_REGS_ADDRESSMAP_H
+#define HOST_HARDWARE_REGS_ADDRESSMAP_H
+
+#include <cstdint>
+
+// Flash is a file mapped into memory, see flash_file.cpp
+const uint8_t* host_flash_image();
+#define XIP_BASE (reinterpret_cast<uintptr_t>(host_flash_image()))
+
+#endif // HOST_HARDWARE_REGS_ADDRESSMAP_H
@@ -0,0 +1,15 @@
+#ifndef HOST_HARDWARE_STRUCTS_ROSC_H
+#define HOST_HARDWARE_STRUCTS_ROSC_H
+
+#include <cstdint>
+
+typedef struct {
+    uint32_t ctrl;
+} rosc_hw_t;
+
+extern rosc_hw_t* rosc_hw;  // Written before a reboot, nothing reads it back
+
+#define ROSC_CTRL_ENABLE_LSB 12
+#define ROSC_CTRL_ENABLE_VALUE_ENABLE 0xfab
+
+#endif // HOST_HARDWARE_STRUCTS_ROSC_H
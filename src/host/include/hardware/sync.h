@@ -0,0 +1,11 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+#include <cstdint>
+
+// Core 0 runs as two threads, the main loop and the lwIP poll thread standing in for its interrupts. Disabling
+// interrupts takes a lock they share, so code guarded this way still never interleaves with an lwIP callback.
+uint32_t save_and_disable_interrupts();
+void restore_interrupts(uint32_t status);
+
+#endif // HOST_HARDWARE_SYNC_H
@@ -0,0 +1,9 @@
+#ifndef HOST_HARDWARE_WATCHDOG_H
+#define HOST_HARDWARE_WATCHDOG_H
+
+#include <cstdint>
+
+// Rebooting ends the simulator, whatever runs it can start it again
+[[noreturn]] void watchdog_reboot(uint32_t pc, uint32_t sp, uint32_t delay_ms);
+
+#endif // HOST_HARDWARE_WATCHDOG_H
@@ -0,0 +1,22 @@
+#ifndef HOST_HPP
+#define HOST_HPP
+
+#include <cstdint>
+#include <string>
+
+// Settings of the host simulator, made by its main() (or a test) before the firmware starts
+namespace host {
+    bool open_flash(const std::string &path);         // Created erased if it doesn't exist yet
+    void set_refresh_rate(unsigned hz);               // Of the virtual panel, presents wait for its vblank
+    void dump_frames(const std::string &directory);   // Write every presented frame as frame_NNNNNN.ppm
+
+    // The USB loopback standing in for TinyUSB: queue bytes as sent by a host to the CDC or vendor
+    // interface, and take what the firmware wrote back on it so far
+    void usb_receive(bool vendor, const uint8_t *data, size_t len);
+    std::string usb_sent(bool vendor);
+
+    // A datagram as if it arrived from the network, handed to every bound UDP pcb the way the poll thread does
+    void udp_receive(const uint8_t *data, size_t len);
+}
+
+#endif // HOST_HPP
@@ -0,0 +1,58 @@
+#pragma once
+
+// Host build: stands in for the Interstate 75 library with a virtual panel. It keeps the driver's
+// pixel layout and scan order, so matrix.cpp fills and flips its buffers exactly as on the device,
+// and can write every presented frame out as an image (see virtual_panel.cpp).
+
+#include <cstdint>
+#include "pico/stdlib.h"
+
+namespace pimoroni {
+    const uint BIT_DEPTH = 10;
+
+    // 8 bit channel to the 10 bit level driven onto the panel
+    extern const uint16_t GAMMA_10BIT[256];
+
+    struct Pixel {
+        uint32_t color;
+        constexpr Pixel() : color(0) {};
+        constexpr Pixel(uint32_t color) : color(color) {};
+        Pixel(uint8_t r, uint8_t g, uint8_t b) : color((GAMMA_10BIT[b] << 20) | (GAMMA_10BIT[g] << 10) | GAMMA_10BIT[r]) {};
+    };
+
+    enum PanelType {
+        PANEL_GENERIC,
+        PANEL_FM6126A,
+    };
+
+    class Hub75 {
+    public:
+        enum class COLOR_ORDER {
+            RGB,
+            RBG,
+            GRB,
+            GBR,
+            BRG,
+            BGR
+        };
+
+        uint width;
+        uint height;
+        Pixel *back_buffer;             // Scanned out, as the DMA does on the device
+        PanelType panel_type;
+        bool inverted_stb;
+        COLOR_ORDER color_order;
+
+        // Position of the scan, advanced by dma_complete()
+        uint row = 0;
+        uint bit = 0;
+
+        Hub75(uint width, uint height, Pixel *buffer, PanelType panel_type, bool inverted_stb,
+              COLOR_ORDER color_order = COLOR_ORDER::RGB);
+
+        // Runs handler once per row and bit plane from a thread of its own, at the refresh rate set by the simulator
+        void start(void (*handler)());
+        void dma_complete();
+    };
+}
+
@@ -0,0 +1,9 @@
+#ifndef HOST_LWIP_IGMP_H
+#define HOST_LWIP_IGMP_H
+
+#include "lwip/ip_addr.h"
+
+// Joins the group on every UDP socket, bound now or later
+err_t igmp_joingroup(const ip4_addr_t* ifaddr, const ip4_addr_t* groupaddr);
+
+#endif // HOST_LWIP_IGMP_H
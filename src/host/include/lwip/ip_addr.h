@@ -0,0 +1,63 @@
+#ifndef HOST_LWIP_IP_ADDR_H
+#define HOST_LWIP_IP_ADDR_H
+
+// Host build: the slice of the lwIP raw API the server uses, on top of host sockets (see lwip_sockets.cpp).
+// Types and names follow lwIP so server.cpp compiles unchanged.
+
+#include <cstdint>
+#include "lwipopts.h"
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_BUF -2
+#define ERR_RTE -4
+#define ERR_USE -8
+#define ERR_CONN -11
+#define ERR_VAL -6
+#define ERR_ABRT -13
+#define ERR_RST -14
+#define ERR_CLSD -15
+#define ERR_ARG -16
+
+#define IPADDR_TYPE_V4 0U
+#define IPADDR_TYPE_V6 6U
+
+typedef struct ip4_addr {
+    u32_t addr;  // Network byte order
+} ip4_addr_t;
+
+typedef struct ip6_addr {
+    u32_t addr[4];
+    u8_t zone;
+} ip6_addr_t;
+
+typedef struct ip_addr {
+    union {
+        ip6_addr_t ip6;
+        ip4_addr_t ip4;
+    } u_addr;
+    u8_t type;
+} ip_addr_t;
+
+extern const ip_addr_t ip_addr_any;
+#define IP_ADDR_ANY (&ip_addr_any)
+#define ip_2_ip4(ipaddr) (&((ipaddr)->u_addr.ip4))
+
+int ip4addr_aton(const char* cp, ip4_addr_t* addr);
+char* ipaddr_ntoa(const ip_addr_t* addr);
+
+struct netif {
+    struct netif* next;
+    ip_addr_t ip_addr;
+    ip_addr_t ip6_addr[LWIP_IPV6_NUM_ADDRESSES];
+    u8_t ip6_addr_state[LWIP_IPV6_NUM_ADDRESSES];
+};
+
+extern struct netif* netif_list;  // The host's addresses, filled in by cyw43_arch_init()
+
+#endif // HOST_LWIP_IP_ADDR_H
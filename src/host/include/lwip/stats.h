@@ -0,0 +1,37 @@
+#ifndef HOST_LWIP_STATS_H
+#define HOST_LWIP_STATS_H
+
+#include "lwip/ip_addr.h"
+
+// The counters the server reports. The host stack has no heap or pools of its own, they stay at zero.
+
+typedef u16_t STAT_COUNTER;
+
+typedef enum {
+    MEMP_TCP_PCB,
+    MEMP_TCP_SEG,
+    MEMP_PBUF_POOL,
+    MEMP_MAX
+} memp_t;
+
+struct stats_proto {
+    STAT_COUNTER xmit;
+    STAT_COUNTER recv;
+    STAT_COUNTER drop;
+    STAT_COUNTER memerr;
+};
+
+struct stats_mem {
+    const char* name;
+    STAT_COUNTER err;
+};
+
+struct stats_ {
+    struct stats_proto tcp;
+    struct stats_mem mem;
+    struct stats_mem* memp[MEMP_MAX];
+};
+
+extern struct stats_ lwip_stats;
+
+#endif // HOST_LWIP_STATS_H
@@ -0,0 +1,48 @@
+#ifndef HOST_LWIP_TCP_H
+#define HOST_LWIP_TCP_H
+
+#include "lwip/pbuf.h"
+
+#define SOF_KEEPALIVE 0x08U
+#define ip_set_option(pcb, opt) ((pcb)->so_options |= (opt))
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn)(void* arg, struct tcp_pcb* newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err);
+typedef void (*tcp_err_fn)(void* arg, err_t err);
+
+struct tcp_pcb {
+    u8_t so_options;
+    u32_t keep_idle;   // Milliseconds, applied to the socket once the accept callback returns
+    u32_t keep_intvl;
+    u32_t keep_cnt;
+
+    int fd;
+    bool listening;
+    bool closed;       // Freed once the poll thread is done with it
+    void* callback_arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_err_fn errf;
+    u16_t port;
+};
+
+struct tcp_pcb* tcp_new();
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+struct tcp_pcb* tcp_listen_with_backlog(struct tcp_pcb* pcb, u8_t backlog);
+void tcp_arg(struct tcp_pcb* pcb, void* arg);
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept);
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv);
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err);
+void tcp_recved(struct tcp_pcb* pcb, u16_t len);
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb* pcb);
+u16_t tcp_sndbuf(struct tcp_pcb* pcb);
+err_t tcp_close(struct tcp_pcb* pcb);
+void tcp_abort(struct tcp_pcb* pcb);
+
+#endif // HOST_LWIP_TCP_H
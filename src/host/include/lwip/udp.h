@@ -0,0 +1,21 @@
+#ifndef HOST_LWIP_UDP_H
+#define HOST_LWIP_UDP_H
+
+#include "lwip/pbuf.h"
+
+struct udp_pcb;
+
+typedef void (*udp_recv_fn)(void* arg, struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* addr, u16_t port);
+
+struct udp_pcb {
+    int fd;
+    udp_recv_fn recv;
+    void* recv_arg;
+};
+
+struct udp_pcb* udp_new();
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port);
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg);
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port);
+
+#endif // HOST_LWIP_UDP_H
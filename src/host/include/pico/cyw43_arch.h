@@ -0,0 +1,23 @@
+#ifndef HOST_PICO_CYW43_ARCH_H
+#define HOST_PICO_CYW43_ARCH_H
+
+#include "pico/stdlib.h"
+
+#define CYW43_AUTH_OPEN 0
+#define CYW43_AUTH_WPA_TKIP_PSK 0x00200002
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+#define CYW43_AUTH_WPA2_MIXED_PSK 0x00400006
+#define CYW43_AUTH_WPA3_SAE_AES_PSK 0x01000004
+#define CYW43_AUTH_WPA3_WPA2_AES_PSK 0x01400004
+
+// The host is already on a network: init starts the thread polling the sockets behind the lwIP API and
+// fills in netif_list, connecting always succeeds.
+int cyw43_arch_init();
+void cyw43_arch_enable_sta_mode();
+int cyw43_arch_wifi_connect_timeout_ms(const char* ssid, const char* pw, uint32_t auth, uint32_t timeout);
+
+// Held by the poll thread while it runs callbacks, as lwIP runs them from an interrupt on the device
+void cyw43_arch_lwip_begin();
+void cyw43_arch_lwip_end();
+
+#endif // HOST_PICO_CYW43_ARCH_H
@@ -0,0 +1,9 @@
+#ifndef HOST_PICO_FLASH_H
+#define HOST_PICO_FLASH_H
+
+#include "pico/stdlib.h"
+
+// Nothing runs from the flash file, so only core 0's interrupts need to be held off
+int flash_safe_execute(void (*func)(void*), void* param, uint32_t enter_exit_timeout_ms);
+
+#endif // HOST_PICO_FLASH_H
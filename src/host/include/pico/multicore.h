@@ -0,0 +1,9 @@
+#ifndef HOST_PICO_MULTICORE_H
+#define HOST_PICO_MULTICORE_H
+
+#include "pico/stdlib.h"
+
+void multicore_launch_core1(void (*entry)(void));  // Core 1 is a thread of its own
+void multicore_lockout_victim_init();
+
+#endif // HOST_PICO_MULTICORE_H
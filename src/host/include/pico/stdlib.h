@@ -0,0 +1,38 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+// Host build: the parts of the Pico SDK the firmware uses, backed by the C++ runtime
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include "hardware/regs/addressmap.h"
+#include "hardware/sync.h"
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK 0
+#define PICO_FLASH_SIZE_BYTES (4 * 1024 * 1024)  // As on the Pico 2 W the board is based on
+
+#define __isr
+#define __not_in_flash_func(func) func
+#define __time_critical_func(func) func
+
+uint64_t time_us_64();
+inline uint32_t time_us_32() { return static_cast<uint32_t>(time_us_64()); }
+
+inline absolute_time_t get_absolute_time() { return time_us_64(); }
+inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+inline uint32_t to_ms_since_boot(absolute_time_t t) { return static_cast<uint32_t>(t / 1000); }
+inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + ms * 1000ull; }
+
+void sleep_us(uint64_t us);
+void sleep_ms(uint32_t ms);
+void tight_loop_contents();  // Yields, busy waits would otherwise starve the other threads
+uint get_core_num();         // 1 on the thread multicore_launch_core1 started, 0 elsewhere
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,23 @@
+#ifndef HOST_TUSB_H
+#define HOST_TUSB_H
+
+#include "pico/stdlib.h"
+
+// The TinyUSB device calls the USB handler makes, answered by a loopback (see host::usb_receive): interfaces
+// are always mounted, reads drain what was queued for them and writes are kept for host::usb_sent.
+bool tusb_init();
+void tud_task();
+
+bool tud_cdc_connected();
+uint32_t tud_cdc_available();
+uint32_t tud_cdc_read(void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_write(const void* buffer, uint32_t bufsize);
+uint32_t tud_cdc_write_flush();
+
+bool tud_vendor_mounted();
+uint32_t tud_vendor_available();
+uint32_t tud_vendor_read(void* buffer, uint32_t bufsize);
+uint32_t tud_vendor_write(const void* buffer, uint32_t bufsize);
+uint32_t tud_vendor_write_flush();
+
+#endif // HOST_TUSB_H
@@ -0,0 +1,466 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#undef TCP_MSS  // The host's, lwipopts.h has lwIP's
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/igmp.h"
+#include "lwip/stats.h"
+#include "pico/cyw43_arch.h"
+#include "core0.hpp"
+#include "host.hpp"
+
+// lwIP's raw API over host sockets. One thread polls every socket and runs the callbacks with the core 0
+// lock held, the way lwIP runs them from an interrupt on the device. Sockets stay blocking: they are only
+// read once poll() says so, and a write blocking for a slow reader is the simulator's backpressure.
+
+#define POLL_INTERVAL_MS 20
+#define RECV_SIZE TCP_WND          // ✅ The most a TCP segment train hands the server in one pbuf on the device
+#define UDP_RECV_SIZE 0xffff
+
+const ip_addr_t ip_addr_any = {};
+
+static struct stats_mem memp_stats[MEMP_MAX] = {{"TCP_PCB", 0}, {"TCP_SEG", 0}, {"PBUF_POOL", 0}};
+struct stats_ lwip_stats = {{0, 0, 0, 0}, {"MEM", 0}, {&memp_stats[0], &memp_stats[1], &memp_stats[2]}};
+
+static struct netif host_netif;
+struct netif* netif_list = &host_netif;
+
+static std::vector<tcp_pcb*> tcp_pcbs;
+static std::vector<udp_pcb*> udp_pcbs;
+static std::vector<ip4_addr_t> multicast_groups;
+
+int ip4addr_aton(const char* cp, ip4_addr_t* addr) {
+    in_addr parsed;
+    if (!inet_aton(cp, &parsed)) {
+        return 0;
+    }
+    addr->addr = parsed.s_addr;
+    return 1;
+}
+
+char* ipaddr_ntoa(const ip_addr_t* addr) {
+    static char text[INET6_ADDRSTRLEN];
+    if (addr->type == IPADDR_TYPE_V6) {
+        inet_ntop(AF_INET6, addr->u_addr.ip6.addr, text, sizeof(text));
+    } else {
+        inet_ntop(AF_INET, &addr->u_addr.ip4.addr, text, sizeof(text));
+    }
+    return text;
+}
+
+struct pbuf* pbuf_alloc(pbuf_layer, u16_t length, pbuf_type) {
+    auto* p = static_cast<pbuf*>(std::malloc(sizeof(pbuf) + length));
+    if (!p) {
+        return nullptr;
+    }
+    p->next = nullptr;
+    p->payload = p + 1;
+    p->tot_len = length;
+    p->len = length;
+    return p;
+}
+
+u8_t pbuf_free(struct pbuf* p) {
+    std::free(p);
+    return 1;
+}
+
+u16_t pbuf_copy_partial(const struct pbuf* p, void* dataptr, u16_t len, u16_t offset) {
+    if (offset >= p->len) {
+        return 0;
+    }
+    u16_t copied = std::min<u16_t>(len, p->len - offset);
+    std::memcpy(dataptr, static_cast<const uint8_t*>(p->payload) + offset, copied);
+    return copied;
+}
+
+err_t pbuf_take(struct pbuf* buf, const void* dataptr, u16_t len) {
+    if (len > buf->tot_len) {
+        return ERR_ARG;
+    }
+    std::memcpy(buf->payload, dataptr, len);
+    return ERR_OK;
+}
+
+static sockaddr_in to_sockaddr(const ip_addr_t* ipaddr, u16_t port) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = ipaddr ? ipaddr->u_addr.ip4.addr : INADDR_ANY;
+    addr.sin_port = htons(port);
+    return addr;
+}
+
+struct tcp_pcb* tcp_new() {
+    auto* pcb = new tcp_pcb{};
+    pcb->fd = -1;
+    return pcb;
+}
+
+err_t tcp_bind(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port) {
+    pcb->fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (pcb->fd < 0) {
+        return ERR_MEM;
+    }
+
+    int on = 1;
+    setsockopt(pcb->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = to_sockaddr(ipaddr, port);
+    if (bind(pcb->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("tcp_bind");
+        return ERR_USE;
+    }
+    pcb->port = port;
+    return ERR_OK;
+}
+
+struct tcp_pcb* tcp_listen_with_backlog(struct tcp_pcb* pcb, u8_t backlog) {
+    if (listen(pcb->fd, backlog) != 0) {
+        return nullptr;
+    }
+    pcb->listening = true;
+    tcp_pcbs.push_back(pcb);
+    return pcb;
+}
+
+void tcp_arg(struct tcp_pcb* pcb, void* arg) {
+    pcb->callback_arg = arg;
+}
+
+void tcp_accept(struct tcp_pcb* pcb, tcp_accept_fn accept) {
+    pcb->accept = accept;
+}
+
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv) {
+    pcb->recv = recv;
+}
+
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err) {
+    pcb->errf = err;
+}
+
+void tcp_recved(struct tcp_pcb*, u16_t) {
+    // ✅ The host stack opens the window as the socket is read
+}
+
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t) {
+    if (pcb->closed || send(pcb->fd, dataptr, len, MSG_NOSIGNAL) != len) {
+        return ERR_CONN;
+    }
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb*) {
+    return ERR_OK;  // ✅ Nagle is off, tcp_write has already sent it
+}
+
+u16_t tcp_sndbuf(struct tcp_pcb*) {
+    return TCP_SND_BUF;
+}
+
+static void release(struct tcp_pcb* pcb) {
+    if (pcb->fd >= 0) {
+        close(pcb->fd);
+        pcb->fd = -1;
+    }
+    pcb->closed = true;  // ✅ Callbacks may still hold it, the poll thread frees it on its next round
+}
+
+err_t tcp_close(struct tcp_pcb* pcb) {
+    release(pcb);
+    if (std::find(tcp_pcbs.begin(), tcp_pcbs.end(), pcb) == tcp_pcbs.end()) {
+        delete pcb;  // Never listened, the poll thread doesn't know it
+    }
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb* pcb) {
+    if (pcb->fd >= 0) {
+        linger reset = {1, 0};  // ✅ Close with a RST, as lwIP does
+        setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+    }
+    release(pcb);
+    if (pcb->errf) {
+        pcb->errf(pcb->callback_arg, ERR_ABRT);
+    }
+}
+
+struct udp_pcb* udp_new() {
+    auto* pcb = new udp_pcb{};
+    pcb->fd = -1;
+    return pcb;
+}
+
+static void join_group(struct udp_pcb* pcb, const ip4_addr_t& group) {
+    ip_mreq request = {};
+    request.imr_multiaddr.s_addr = group.addr;
+    request.imr_interface.s_addr = INADDR_ANY;
+    if (setsockopt(pcb->fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) != 0) {
+        std::perror("Joining multicast group, only unicast UDP will arrive");
+    }
+}
+
+err_t udp_bind(struct udp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port) {
+    pcb->fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (pcb->fd < 0) {
+        return ERR_MEM;
+    }
+
+    // ✅ Several simulators on one host can all listen to the multicast group
+    int on = 1;
+    setsockopt(pcb->fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = to_sockaddr(ipaddr, port);
+    if (bind(pcb->fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::perror("udp_bind");
+        return ERR_USE;
+    }
+
+    for (const ip4_addr_t& group: multicast_groups) {
+        join_group(pcb, group);
+    }
+    udp_pcbs.push_back(pcb);
+    return ERR_OK;
+}
+
+void udp_recv(struct udp_pcb* pcb, udp_recv_fn recv, void* recv_arg) {
+    pcb->recv = recv;
+    pcb->recv_arg = recv_arg;
+}
+
+err_t udp_sendto(struct udp_pcb* pcb, struct pbuf* p, const ip_addr_t* dst_ip, u16_t dst_port) {
+    sockaddr_in addr = to_sockaddr(dst_ip, dst_port);
+    if (sendto(pcb->fd, p->payload, p->len, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != p->len) {
+        return ERR_RTE;
+    }
+    return ERR_OK;
+}
+
+err_t igmp_joingroup(const ip4_addr_t*, const ip4_addr_t* groupaddr) {
+    multicast_groups.push_back(*groupaddr);
+    for (udp_pcb* pcb: udp_pcbs) {
+        join_group(pcb, *groupaddr);
+    }
+    return ERR_OK;
+}
+
+static void accept_connection(tcp_pcb* listener) {
+    int fd = accept(listener->fd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    tcp_pcb* pcb = tcp_new();
+    pcb->fd = fd;
+    pcb->callback_arg = listener->callback_arg;
+    tcp_pcbs.push_back(pcb);
+
+    err_t err = listener->accept ? listener->accept(listener->callback_arg, pcb, ERR_OK) : ERR_VAL;
+    if (pcb->closed) {
+        return;
+    }
+    if (err != ERR_OK) {
+        tcp_abort(pcb);
+        return;
+    }
+
+    // ✅ Applied now the accept callback has set them, in whole seconds as the host counts them
+    if (pcb->so_options & SOF_KEEPALIVE) {
+        int idle = std::max<int>(pcb->keep_idle / 1000, 1);
+        int interval = std::max<int>(pcb->keep_intvl / 1000, 1);
+        int count = pcb->keep_cnt;
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+        setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+    }
+}
+
+static void receive_tcp(tcp_pcb* pcb) {
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, RECV_SIZE, PBUF_RAM);
+    ssize_t length = recv(pcb->fd, p->payload, RECV_SIZE, 0);
+
+    if (length < 0) {
+        // ✅ As lwIP, the pcb is gone by the time the error callback hears about it
+        err_t err = errno == ETIMEDOUT ? ERR_ABRT : ERR_RST;
+        pbuf_free(p);
+        release(pcb);
+        if (pcb->errf) {
+            pcb->errf(pcb->callback_arg, err);
+        }
+        return;
+    }
+
+    if (length == 0) {
+        pbuf_free(p);
+        p = nullptr;  // ✅ The peer closed, lwIP signals it with an empty receive
+    } else {
+        p->tot_len = p->len = length;
+    }
+
+    if (pcb->recv) {
+        pcb->recv(pcb->callback_arg, pcb, p, ERR_OK);
+    } else if (p) {
+        pbuf_free(p);
+    } else {
+        tcp_close(pcb);
+    }
+}
+
+static void receive_udp(udp_pcb* pcb) {
+    pbuf* p = pbuf_alloc(PBUF_TRANSPORT, UDP_RECV_SIZE, PBUF_RAM);
+    sockaddr_in from = {};
+    socklen_t from_len = sizeof(from);
+    ssize_t length = recvfrom(pcb->fd, p->payload, UDP_RECV_SIZE, 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+    if (length < 0 || !pcb->recv) {
+        pbuf_free(p);
+        return;
+    }
+    p->tot_len = p->len = length;
+
+    ip_addr_t addr = {};
+    addr.type = IPADDR_TYPE_V4;
+    addr.u_addr.ip4.addr = from.sin_addr.s_addr;
+    pcb->recv(pcb->recv_arg, pcb, p, &addr, ntohs(from.sin_port));  // ✅ Frees p, as with lwIP
+}
+
+void host::udp_receive(const uint8_t* data, size_t len) {
+    ip_addr_t addr = {};
+    addr.type = IPADDR_TYPE_V4;
+    addr.u_addr.ip4.addr = htonl(INADDR_LOOPBACK);
+
+    std::lock_guard<std::recursive_mutex> guard(core0_lock());
+    for (udp_pcb* pcb: udp_pcbs) {
+        if (!pcb->recv) {
+            continue;
+        }
+        pbuf* p = pbuf_alloc(PBUF_TRANSPORT, len, PBUF_RAM);
+        std::memcpy(p->payload, data, len);
+        pcb->recv(pcb->recv_arg, pcb, p, &addr, 0);
+    }
+}
+
+static void poll_sockets() {
+    std::vector<pollfd> fds;
+    std::vector<tcp_pcb*> tcp_ready;
+    std::vector<udp_pcb*> udp_ready;
+
+    while (true) {
+        fds.clear();
+        tcp_ready.clear();
+        udp_ready.clear();
+        {
+            std::lock_guard<std::recursive_mutex> guard(core0_lock());
+
+            // ✅ Free what was closed last round, nothing refers to it any more
+            tcp_pcbs.erase(std::remove_if(tcp_pcbs.begin(), tcp_pcbs.end(), [](tcp_pcb* pcb) {
+                if (pcb->closed) {
+                    delete pcb;
+                    return true;
+                }
+                return false;
+            }), tcp_pcbs.end());
+
+            for (tcp_pcb* pcb: tcp_pcbs) {
+                fds.push_back({pcb->fd, POLLIN, 0});
+                tcp_ready.push_back(pcb);
+            }
+            for (udp_pcb* pcb: udp_pcbs) {
+                fds.push_back({pcb->fd, POLLIN, 0});
+                udp_ready.push_back(pcb);
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), POLL_INTERVAL_MS) <= 0) {
+            continue;
+        }
+
+        std::lock_guard<std::recursive_mutex> guard(core0_lock());
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            if (i < tcp_ready.size()) {
+                tcp_pcb* pcb = tcp_ready[i];
+                if (pcb->closed) {
+                    continue;  // ✅ Closed by a callback earlier in this round
+                }
+                if (pcb->listening) {
+                    accept_connection(pcb);
+                } else {
+                    receive_tcp(pcb);
+                }
+            } else {
+                receive_udp(udp_ready[i - tcp_ready.size()]);
+            }
+        }
+    }
+}
+
+static void find_addresses() {
+    host_netif.ip_addr.type = IPADDR_TYPE_V4;
+    host_netif.ip_addr.u_addr.ip4.addr = htonl(INADDR_LOOPBACK);
+
+    ifaddrs* interfaces = nullptr;
+    if (getifaddrs(&interfaces) != 0) {
+        return;
+    }
+
+    // ✅ The first address of an interface that's up and isn't loopback, as the device has just the one
+    bool have_ipv4 = false;
+    int ipv6_count = 0;
+    for (ifaddrs* ifa = interfaces; ifa; ifa = ifa->ifa_next) {
+        if (!ifa->ifa_addr || (ifa->ifa_flags & IFF_LOOPBACK) || !(ifa->ifa_flags & IFF_UP)) {
+            continue;
+        }
+        if (ifa->ifa_addr->sa_family == AF_INET && !have_ipv4) {
+            host_netif.ip_addr.u_addr.ip4.addr = reinterpret_cast<sockaddr_in*>(ifa->ifa_addr)->sin_addr.s_addr;
+            have_ipv4 = true;
+        } else if (ifa->ifa_addr->sa_family == AF_INET6 && ipv6_count < LWIP_IPV6_NUM_ADDRESSES) {
+            ip_addr_t& addr = host_netif.ip6_addr[ipv6_count];
+            addr.type = IPADDR_TYPE_V6;
+            std::memcpy(addr.u_addr.ip6.addr, &reinterpret_cast<sockaddr_in6*>(ifa->ifa_addr)->sin6_addr, 16);
+            host_netif.ip6_addr_state[ipv6_count++] = 0x30;  // ✅ IP6_ADDR_PREFERRED
+        }
+    }
+    freeifaddrs(interfaces);
+}
+
+int cyw43_arch_init() {
+    static bool started = false;
+    if (!started) {
+        find_addresses();
+        std::thread(poll_sockets).detach();
+        started = true;
+    }
+    return 0;
+}
+
+void cyw43_arch_enable_sta_mode() {
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(const char*, const char*, uint32_t, uint32_t) {
+    return 0;
+}
+
+void cyw43_arch_lwip_begin() {
+    core0_lock().lock();
+}
+
+void cyw43_arch_lwip_end() {
+    core0_lock().unlock();
+}
@@ -0,0 +1,72 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "host.hpp"
+#include "matrix.hpp"
+#include "server.hpp"
+#include "config_storage.hpp"
+#include "pico/cyw43_arch.h"
+
+// The firmware's main() without USB, for running the protocol against a virtual panel on a host:
+//   multiverse-sim [--flash FILE] [--frames DIR] [--refresh HZ] [--port PORT]
+// Settings persist in the flash file like they do on the device, --port is set without being committed to it.
+
+static void usage(const char* name) {
+    std::fprintf(stderr, "Usage: %s [--flash FILE] [--frames DIR] [--refresh HZ] [--port PORT]\n"
+                         "  --flash FILE   flash image, created if missing (default multiverse-flash.bin)\n"
+                         "  --frames DIR   write every presented frame to DIR as frame_NNNNNN.ppm\n"
+                         "  --refresh HZ   virtual panel refresh rate, presents wait for its vblank (default 120)\n"
+                         "  --port PORT    TCP port for this run, overriding the stored one\n", name);
+}
+
+int main(int argc, char** argv) {
+    std::string flash_path = "multiverse-flash.bin";
+    std::string port;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc;
+        if (!strcmp(argv[i], "--flash") && has_value) {
+            flash_path = argv[++i];
+        } else if (!strcmp(argv[i], "--frames") && has_value) {
+            host::dump_frames(argv[++i]);
+        } else if (!strcmp(argv[i], "--refresh") && has_value) {
+            host::set_refresh_rate(std::atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--port") && has_value) {
+            port = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (!host::open_flash(flash_path)) {
+        return 1;
+    }
+
+    KVStore kvStore;
+    if (!port.empty()) {
+        kvStore.setParam("port", port);
+    }
+
+    matrix::init(kvStore);
+
+    ApiServer server(kvStore);
+
+    if (!server.start()) {
+        matrix::print("Failed to start TCP server");
+        return 1;
+    }
+
+    // ✅ lwIP callbacks may already be running on the poll thread
+    cyw43_arch_lwip_begin();
+    matrix::print("TCP server started on " + server.ipv4addr() + ":" + kvStore.getParam("port"));
+    cyw43_arch_lwip_end();
+    std::printf("Listening on %s:%s\n", ApiServer::ipv4addr().c_str(), kvStore.getParam("port").c_str());
+    std::fflush(stdout);
+
+    while (true) {
+        sleep_ms(1000);
+    }
+}
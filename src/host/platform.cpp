@@ -0,0 +1,85 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/bootrom.h"
+#include "pico/flash.h"
+#include "hardware/sync.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/rosc.h"
+#include "core0.hpp"
+
+static const auto boot_time = std::chrono::steady_clock::now();
+
+static rosc_hw_t rosc;
+rosc_hw_t* rosc_hw = &rosc;
+
+std::recursive_mutex& core0_lock() {
+    static std::recursive_mutex lock;
+    return lock;
+}
+
+uint64_t time_us_64() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - boot_time).count();
+}
+
+void sleep_us(uint64_t us) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+void sleep_ms(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void tight_loop_contents() {
+    std::this_thread::yield();
+}
+
+uint32_t save_and_disable_interrupts() {
+    core0_lock().lock();
+    return 0;
+}
+
+void restore_interrupts(uint32_t) {
+    core0_lock().unlock();
+}
+
+static thread_local uint core_num = 0;
+
+uint get_core_num() {
+    return core_num;
+}
+
+void set_core_num(uint core) {
+    core_num = core;
+}
+
+void multicore_launch_core1(void (*entry)(void)) {
+    std::thread([entry] {
+        core_num = 1;
+        entry();
+    }).detach();
+}
+
+void multicore_lockout_victim_init() {
+}
+
+int flash_safe_execute(void (*func)(void*), void* param, uint32_t) {
+    std::lock_guard<std::recursive_mutex> guard(core0_lock());
+    func(param);
+    return PICO_OK;
+}
+
+void watchdog_reboot(uint32_t, uint32_t, uint32_t) {
+    std::fprintf(stderr, "Reboot requested, exiting\n");
+    std::fflush(nullptr);
+    std::_Exit(0);
+}
+
+void reset_usb_boot(uint32_t, uint32_t) {
+    std::fprintf(stderr, "BOOTSEL requested, exiting\n");
+    std::fflush(nullptr);
+    std::_Exit(0);
+}
@@ -0,0 +1,90 @@
+#include "command_config.hpp"
+#include "replay.hpp"
+
+// Feeds frames through ApiServer::ingest (by way of a session) cut into every split a transport could produce,
+// and checks the framebuffer ends up byte for byte what was sent. Each stream is a full frame followed by the
+// message under test, so the splits straddle message boundaries as well.
+
+using namespace replay;
+
+static KVStore* kv_store;
+static ApiServer* server;
+static RecvState* session;
+
+// Every path a frame takes into the framebuffer: raw, packed, a region, zipped and XOR-delta zipped
+static const char* const COMMANDS[] = {CommandConfig::DATA, CommandConfig::SHOWDATA, CommandConfig::SHOWDATA888,
+                                       CommandConfig::SHOWRECT, CommandConfig::SHOWZIPPED,
+                                       CommandConfig::DELTAZIPPED};
+
+static std::string replies;  // ✅ Text the server sent back on the session
+
+static void collect_reply(void*, const uint8_t* data, size_t len) {
+    replies.append(reinterpret_cast<const char*>(data), len);
+}
+
+static void feed(const Bytes& bytes) {
+    ApiServer::feed_session(session, bytes.data(), bytes.size());
+}
+
+static Bytes delta(const Bytes& from, const Bytes& to) {
+    Bytes bytes(to.size());
+    for (size_t i = 0; i < to.size(); i++) {
+        bytes[i] = from[i] ^ to[i];
+    }
+    return zipped(bytes);
+}
+
+static void replay_case(const Case& c, const std::vector<size_t>& pieces, const std::string& splits) {
+    size_t offset = 0;
+    for (size_t piece : pieces) {
+        ApiServer::feed_session(session, c.stream.data() + offset, piece);
+        offset += piece;
+    }
+    check_framebuffer(c, "split " + splits);
+}
+
+int main() {
+    start_firmware(kv_store, server);
+    session = server->open_session(collect_reply);
+
+    std::mt19937 rng(20240601);
+
+    for (const char* command : COMMANDS) {
+        for (size_t i = 0; i < RECORDED_SPLITS.size(); i++) {
+            Case c = make_case(rng, command);
+            replay_case(c, cut(c.stream.size(), RECORDED_SPLITS[i]), "recorded #" + std::to_string(i));
+        }
+        for (int run = 0; run < 20; run++) {
+            Case c = make_case(rng, command);
+            replay_case(c, cut(c.stream.size(), rng), "random #" + std::to_string(run));
+        }
+    }
+
+    // ✅ A delta cut short leaves part of itself in the framebuffer: deltas are refused, and the sender told
+    // so, until a keyframe lands
+    for (const char* keyframe : {CommandConfig::SHOWZIPPED, CommandConfig::DATA}) {
+        const std::string name = std::string("delta after a broken one, then ") + keyframe;
+        Bytes base = random_frame(rng, matrix::BUFFER_SIZE);
+        Bytes next = random_frame(rng, matrix::BUFFER_SIZE);
+        feed(message(CommandConfig::DATA, base));
+        Bytes broken = delta(base, next);
+        broken.resize(broken.size() / 2);
+        feed(message(CommandConfig::DELTAZIPPED, broken));
+
+        matrix::acquire();
+        Case left{name, {}, Bytes(matrix::buffer, matrix::buffer + matrix::BUFFER_SIZE)};
+        replies.clear();
+        feed(message(CommandConfig::DELTAZIPPED, delta(base, next)));
+        check_framebuffer(left, "refused");
+        check(replies.find("keyframe") != std::string::npos, name + ": sender told to send a keyframe");
+
+        Bytes payload = std::string(keyframe) == CommandConfig::DATA ? next : zipped(next);
+        feed(message(keyframe, payload));
+        Bytes last = random_frame(rng, matrix::BUFFER_SIZE);
+        feed(message(CommandConfig::DELTAZIPPED, delta(next, last)));
+        check_framebuffer({name, {}, last}, "accepted");
+    }
+
+    std::printf("ingest_test: %d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
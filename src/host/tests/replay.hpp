@@ -0,0 +1,231 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <zlib.h>
+
+#include "command_config.hpp"
+#include "host.hpp"
+#include "matrix.hpp"
+#include "server.hpp"
+#include "config_storage.hpp"
+
+// Shared by the host tests: building messages and test cases, and cutting a byte stream the way a transport
+// would deliver it
+namespace replay {
+    using Bytes = std::vector<uint8_t>;
+
+    inline int failures = 0;
+
+    inline void check(bool condition, const std::string& what) {
+        if (!condition) {
+            std::fprintf(stderr, "FAIL: %s\n", what.c_str());
+            failures++;
+        }
+    }
+
+    // A message framed as on a TCP connection: prefix, big endian payload size, command
+    inline Bytes message(const char* command, const Bytes& payload = {}) {
+        Bytes bytes(MESSAGE_PREFIX, MESSAGE_PREFIX + PREFIX_LENGTH);
+        uint32_t size = payload.size();
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            bytes.push_back(size >> shift);
+        }
+        bytes.insert(bytes.end(), command, command + 4);
+        bytes.insert(bytes.end(), payload.begin(), payload.end());
+        return bytes;
+    }
+
+    // A command as sent over USB, without the size field of the TCP header
+    inline Bytes usb_message(const char* command, const Bytes& payload = {}) {
+        Bytes bytes = message(command, payload);
+        bytes.erase(bytes.begin() + PREFIX_LENGTH, bytes.begin() + PREFIX_LENGTH + 4);
+        return bytes;
+    }
+
+    inline Bytes big_endian16(std::initializer_list<uint16_t> values) {
+        Bytes bytes;
+        for (uint16_t value : values) {
+            bytes.push_back(value >> 8);
+            bytes.push_back(value);
+        }
+        return bytes;
+    }
+
+    inline Bytes zipped(const Bytes& data) {
+        uLongf size = compressBound(data.size());
+        Bytes out(size);
+        compress2(out.data(), &size, data.data(), data.size(), Z_BEST_SPEED);
+        out.resize(size);
+        return out;
+    }
+
+    // Smooth enough to compress, noisy enough that a misplaced byte shows
+    inline Bytes random_frame(std::mt19937& rng, size_t size) {
+        Bytes frame(size);
+        uint8_t level = rng();
+        for (size_t i = 0; i < size; i++) {
+            if (rng() % 16 == 0) level = rng();
+            frame[i] = level + i % 4;
+        }
+        return frame;
+    }
+
+    // Lengths of the pieces `total` bytes arrive in: `pattern` repeated, or random ones of 1 to `max_piece` bytes
+    inline std::vector<size_t> cut(size_t total, const std::vector<size_t>& pattern) {
+        std::vector<size_t> pieces;
+        for (size_t i = 0, taken = 0; taken < total; i++) {
+            size_t piece = std::min(pattern[i % pattern.size()], total - taken);
+            pieces.push_back(piece);
+            taken += piece;
+        }
+        return pieces;
+    }
+
+    inline std::vector<size_t> cut(size_t total, std::mt19937& rng, size_t max_piece = 5000) {
+        std::vector<size_t> pieces;
+        for (size_t taken = 0; taken < total;) {
+            size_t piece = std::min<size_t>(1 + rng() % max_piece, total - taken);
+            pieces.push_back(piece);
+            taken += piece;
+        }
+        return pieces;
+    }
+
+    struct Case {
+        std::string name;
+        Bytes stream;
+        Bytes expected;  // `matrix::buffer` once the stream is in
+    };
+
+    // Packs an RGBX8888 frame in a wire format, and leaves in `frame` what unpacking it gives back
+    inline Bytes pack(Bytes& frame, matrix::PixelFormat format) {
+        Bytes packed;
+        for (size_t i = 0; i < frame.size(); i += 4) {
+            switch (format) {
+                case matrix::PixelFormat::RGB888:
+                    packed.insert(packed.end(), &frame[i], &frame[i] + 3);
+                    break;
+                case matrix::PixelFormat::RGB565: {
+                    uint16_t pixel = (frame[i + 2] >> 3) << 11 | (frame[i + 1] >> 2) << 5 | frame[i] >> 3;
+                    packed.push_back(pixel);
+                    packed.push_back(pixel >> 8);
+
+                    // ✅ Widened again with the top bits replicated into the low ones
+                    frame[i] = (frame[i] & 0xf8) | frame[i] >> 5;
+                    frame[i + 1] = (frame[i + 1] & 0xfc) | frame[i + 1] >> 6;
+                    frame[i + 2] = (frame[i + 2] & 0xf8) | frame[i + 2] >> 5;
+                    break;
+                }
+                default:
+                    return frame;  // ✅ RGBX8888; indexed formats need a palette and have no cases
+            }
+            frame[i + 3] = 0;  // ✅ Unpacked with a zero padding byte
+        }
+        return packed;
+    }
+
+    // A full RGBX8888 frame, then `command` carrying a random frame or region on top of it, framed as on a TCP
+    // connection or, with `usb`, as sent over USB where zipped payloads are led by their compressed size
+    inline Case make_case(std::mt19937& rng, const char* command, bool usb = false) {
+        auto framed = [usb](const char* command, const Bytes& payload) {
+            return usb ? usb_message(command, payload) : message(command, payload);
+        };
+        const CommandConfig::Command* entry = CommandConfig::find(CommandConfig::fourcc(command));
+        const size_t size = matrix::BUFFER_SIZE;
+        Bytes base = random_frame(rng, size);
+        Case c{command, framed(CommandConfig::DATA, base), base};
+        Bytes payload;
+
+        if (entry->flags & CommandConfig::Flag::REGION) {
+            const int x = rng() % 200, y = rng() % 50, w = 1 + rng() % 80, h = 1 + rng() % 20;
+            payload = big_endian16({static_cast<uint16_t>(x), static_cast<uint16_t>(y), static_cast<uint16_t>(w),
+                                    static_cast<uint16_t>(h)});
+            Bytes pixels = random_frame(rng, w * h * 4);
+            payload.insert(payload.end(), pixels.begin(), pixels.end());
+
+            // ✅ Clipped at the panel edge, like PixelWriter does
+            for (int row = 0; row < h && y + row < matrix::HEIGHT; row++) {
+                int visible = std::min(w, matrix::WIDTH - x);
+                std::memcpy(&c.expected[((y + row) * matrix::WIDTH + x) * 4], &pixels[row * w * 4], visible * 4);
+            }
+        } else {
+            c.expected = random_frame(rng, size);
+            payload = pack(c.expected, entry->format);
+            if (entry->flags & CommandConfig::Flag::DELTA) {
+                for (size_t i = 0; i < size; i++) {
+                    payload[i] ^= base[i];
+                }
+            }
+            if (entry->flags & CommandConfig::Flag::ZIPPED) {
+                payload = zipped(payload);
+                if (usb) {
+                    uint32_t zipped_size = payload.size();
+                    payload.insert(payload.begin(), {static_cast<uint8_t>(zipped_size),
+                                   static_cast<uint8_t>(zipped_size >> 8), static_cast<uint8_t>(zipped_size >> 16),
+                                   static_cast<uint8_t>(zipped_size >> 24)});
+                }
+            }
+        }
+
+        Bytes last = framed(command, payload);
+        c.stream.insert(c.stream.end(), last.begin(), last.end());
+        return c;
+    }
+
+    // Once a case's stream is in, `matrix::buffer` holds what it expects; names the first byte that differs
+    inline void check_framebuffer(const Case& c, const std::string& how) {
+        matrix::acquire();
+        size_t mismatch = 0;
+        while (mismatch < matrix::BUFFER_SIZE && matrix::buffer[mismatch] == c.expected[mismatch]) {
+            mismatch++;
+        }
+        check(mismatch == matrix::BUFFER_SIZE,
+              c.name + " " + how + ": framebuffer differs at byte " + std::to_string(mismatch));
+    }
+
+    // Segment splits as seen on the wire: full size segments, small MSS peers, a header dribbled in a byte at
+    // a time, pbuf chains cut at the pool buffer size, and USB bulk packets
+    static const std::vector<std::vector<size_t>> RECORDED_SPLITS = {
+        {1460},
+        {536},
+        {1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1460},
+        {11, 8, 1441, 1460, 1460, 2920},
+        {1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 1460, 732},
+        {64},
+        {4096, 4096, 4096, 1},
+    };
+
+    // Flash, panel and core 1 as the firmware sets them up, shared by every test in the process. `settings` are
+    // stored before the server reads them.
+    inline void start_firmware(KVStore*& kv_store, ApiServer*& server,
+                               const std::vector<std::pair<std::string, std::string>>& settings = {}) {
+        char path[] = "/tmp/multiverse-test-XXXXXX";
+        int fd = mkstemp(path);
+        if (fd < 0 || !host::open_flash(path)) {
+            std::perror(path);
+            std::exit(1);
+        }
+        close(fd);
+        unlink(path);  // ✅ open_flash keeps it open for this run only
+        host::set_refresh_rate(2000);  // ✅ Presents wait for the virtual vblank, keep it short
+
+        kv_store = new KVStore();
+        for (const auto& setting : settings) {
+            kv_store->setParam(setting.first, setting.second);
+        }
+        matrix::init(*kv_store);
+        server = new ApiServer(*kv_store);
+    }
+}
+
+#endif // REPLAY_HPP
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstring>
+#include <dirent.h>
+
+#include "command_config.hpp"
+#include "replay.hpp"
+
+// Sends UDP frame fragments as the multicast listener receives them, alongside messages on a session, and checks
+// who gets to draw: an incomplete UDP frame holds the framebuffer, but only until UDP_FRAME_TIMEOUT_US passes
+// without another fragment. Also checks that only fragments covering the whole frame complete it.
+
+using namespace replay;
+
+static const uint32_t FRAME_TIMEOUT_MS = 100;  // ✅ UDP_FRAME_TIMEOUT_US in server.cpp
+static char frames[] = "/tmp/multiverse-frames-XXXXXX";
+
+// A fragment of a full panel RGBX8888 frame, shown once complete
+static Bytes fragment(uint32_t frame_id, uint32_t offset, uint16_t index, uint16_t count, const Bytes& pixels) {
+    const uint32_t total_size = matrix::BUFFER_SIZE;
+    Bytes bytes = {'m', 'v', 'f', 'r'};
+    for (uint32_t value : {frame_id, offset, total_size}) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            bytes.push_back(value >> shift);
+        }
+    }
+    Bytes rest = {static_cast<uint8_t>(index >> 8), static_cast<uint8_t>(index), static_cast<uint8_t>(count >> 8),
+                  static_cast<uint8_t>(count), 0x01, 0, 0, 0};
+    bytes.insert(bytes.end(), rest.begin(), rest.end());
+    bytes.insert(bytes.end(), pixels.begin(), pixels.end());
+    return bytes;
+}
+
+static void send(RecvState* session, const Bytes& bytes) {
+    ApiServer::feed_session(session, bytes.data(), bytes.size());
+    matrix::acquire();
+    sleep_ms(50);  // ✅ Presented frames wait for the virtual panel's vblank
+}
+
+// Names of the frames the virtual panel presented so far, oldest first
+static std::vector<std::string> presented() {
+    std::vector<std::string> names;
+    DIR* directory = opendir(frames);
+    while (dirent* entry = readdir(directory)) {
+        if (std::strncmp(entry->d_name, "frame_", 6) == 0) names.push_back(entry->d_name);
+    }
+    closedir(directory);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+// The newest presented frame, as PPM pixels
+static Bytes last_frame() {
+    std::vector<std::string> names = presented();
+    if (names.empty()) return {};
+    const std::string& newest = names.back();
+
+    FILE* file = std::fopen((std::string(frames) + "/" + newest).c_str(), "rb");
+    unsigned width = 0, height = 0;
+    Bytes pixels;
+    if (std::fscanf(file, "P6 %u %u 255", &width, &height) == 2 && std::fgetc(file) != EOF) {
+        pixels.resize(width * height * 3);
+        pixels.resize(std::fread(pixels.data(), 1, pixels.size(), file));
+    }
+    std::fclose(file);
+    return pixels;
+}
+
+static bool any_lit(const uint8_t* begin, const uint8_t* end) {
+    return std::any_of(begin, end, [](uint8_t byte) { return byte != 0; });
+}
+
+// ✅ One fragment of two never completes its frame; once it times out, clsc and ovtx draw again
+static void stale_frame_releases_canvas(RecvState* session, std::mt19937& rng) {
+    Bytes row = random_frame(rng, matrix::width() * 4);
+    row[0] |= 1;  // ✅ At least one lit byte to clear
+    Bytes first = fragment(1, 0, 0, 2, row);
+    host::udp_receive(first.data(), first.size());
+    matrix::acquire();
+    check(std::equal(row.begin(), row.end(), matrix::buffer), "fragment lands in the framebuffer");
+
+    send(session, message(CommandConfig::CLEARSCREEN));
+    check(any_lit(matrix::buffer, matrix::buffer + row.size()), "clsc waits while the UDP frame is in flight");
+
+    sleep_ms(FRAME_TIMEOUT_MS * 2);
+    send(session, message(CommandConfig::CLEARSCREEN));
+    check(!any_lit(matrix::buffer, matrix::buffer + matrix::BUFFER_SIZE), "clsc draws once the UDP frame timed out");
+
+    size_t before = presented().size();
+    Bytes text = {0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff, 0, 0, 0, 0, 1, 'M', 'M'};
+    send(session, message(CommandConfig::OVERLAY_TEXT, text));
+    Bytes frame = last_frame();
+    check(presented().size() > before && frame.size() >= static_cast<size_t>(matrix::width()) * 8 * 3 &&
+          any_lit(frame.data(), frame.data() + matrix::width() * 8 * 3),
+          "ovtx is presented once the UDP frame timed out");
+}
+
+// ✅ Two fragments covering the same half of the frame don't add up to a whole one
+static void overlapping_fragments_wait(std::mt19937& rng) {
+    const size_t half = matrix::BUFFER_SIZE / 2;
+    Bytes frame = random_frame(rng, matrix::BUFFER_SIZE);
+    Bytes top(frame.begin(), frame.begin() + half), bottom(frame.begin() + half, frame.end());
+
+    size_t before = presented().size();
+    for (uint16_t index : {0, 1}) {
+        Bytes bytes = fragment(2, 0, index, 3, top);
+        host::udp_receive(bytes.data(), bytes.size());
+    }
+    matrix::acquire();
+    sleep_ms(50);
+    check(presented().size() == before, "overlapping fragments don't complete the frame");
+
+    Bytes last = fragment(2, half, 2, 3, bottom);
+    host::udp_receive(last.data(), last.size());
+    matrix::acquire();
+    sleep_ms(50);
+    check(presented().size() > before, "the fragment covering the rest completes it");
+    check(std::equal(frame.begin(), frame.end(), matrix::buffer), "completed frame lands in the framebuffer");
+}
+
+// ✅ An offset that only fits the frame once the sum wraps is refused without claiming the canvas
+static void wrapping_offset_rejected(RecvState* session, std::mt19937& rng) {
+    Bytes pixels = random_frame(rng, 32);
+    Bytes bytes = fragment(3, 0xffffffe0, 0, 2, pixels);
+    host::udp_receive(bytes.data(), bytes.size());
+
+    Bytes row = random_frame(rng, matrix::width() * 4);
+    row[0] |= 1;
+    send(session, message(CommandConfig::DATA, row));
+    send(session, message(CommandConfig::CLEARSCREEN));
+    check(!any_lit(matrix::buffer, matrix::buffer + matrix::BUFFER_SIZE), "clsc draws after a wrapping fragment");
+}
+
+int main() {
+    if (!mkdtemp(frames)) {
+        std::perror(frames);
+        return 1;
+    }
+    host::dump_frames(frames);
+
+    KVStore* kv_store;
+    ApiServer* server;
+    start_firmware(kv_store, server, {{"port", "0"}});  // ✅ Any free TCP port, only UDP is used
+    server->start();
+    RecvState* session = server->open_session();
+
+    std::mt19937 rng(20240611);
+    stale_frame_releases_canvas(session, rng);
+    overlapping_fragments_wait(rng);
+    wrapping_offset_rejected(session, rng);
+
+    for (const std::string& name : presented()) {
+        unlink((std::string(frames) + "/" + name).c_str());
+    }
+    rmdir(frames);
+
+    std::printf("udp_test: %d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#include "command_config.hpp"
+#include "replay.hpp"
+#include "usb_handler.hpp"
+
+// Sends frames the way examples/matrix.py does over USB (the prefix and command, then a payload whose size the
+// command implies) through the USB loopback, in packets and bursts on either interface, and checks the
+// framebuffer ends up byte for byte what was sent. Runs the real UsbHandler parser and the ApiServer session
+// behind it, including raw frames read from the endpoint FIFO straight into the framebuffer.
+
+using namespace replay;
+
+static KVStore* kv_store;
+static ApiServer* server;
+static UsbHandler* usb;
+
+// Every frame format a client sends over USB, full frames and regions, each following a full frame
+static const char* const COMMANDS[] = {CommandConfig::DATA, CommandConfig::DATA565, CommandConfig::RECT,
+                                       CommandConfig::ZIPPED};
+
+// Queues the pieces on an interface, polling after every `per_poll` of them as if more arrived in between
+static void replay_case(const Case& c, bool vendor, const std::vector<size_t>& pieces, size_t per_poll,
+                        const std::string& splits) {
+    size_t offset = 0;
+    for (size_t i = 0; i < pieces.size(); i++) {
+        host::usb_receive(vendor, c.stream.data() + offset, pieces[i]);
+        offset += pieces[i];
+        if ((i + 1) % per_poll == 0) usb->poll();
+    }
+    for (int i = 0; i < 64; i++) {
+        usb->poll();  // ✅ Whatever is still queued, a poll takes at most a chunk of it
+    }
+    check_framebuffer(c, std::string(vendor ? "vendor" : "cdc") + " split " + splits);
+}
+
+int main() {
+    start_firmware(kv_store, server);
+    usb = new UsbHandler(*kv_store, *server);
+
+    std::mt19937 rng(20240602);
+
+    for (const char* command : COMMANDS) {
+        for (bool vendor : {true, false}) {
+            Case c = make_case(rng, command, true);
+            replay_case(c, vendor, cut(c.stream.size(), {64}), 1, "64 byte packets");
+            c = make_case(rng, command, true);
+            replay_case(c, vendor, cut(c.stream.size(), {64}), 128, "8 KiB bursts");
+            c = make_case(rng, command, true);
+            replay_case(c, vendor, cut(c.stream.size(), {1, 63, 64, 3, 4093}), 1, "uneven");
+
+            for (int run = 0; run < 10; run++) {
+                c = make_case(rng, command, true);
+                replay_case(c, vendor, cut(c.stream.size(), rng), 1 + run % 3, "random #" + std::to_string(run));
+            }
+        }
+    }
+
+    // ✅ A region whose size wraps 32 bits is refused, the frame after it still lands
+    Case c = make_case(rng, CommandConfig::DATA, true);
+    Bytes oversized = usb_message(CommandConfig::RECT, {0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff});
+    c.stream.insert(c.stream.begin(), oversized.begin(), oversized.end());
+    replay_case(c, true, {c.stream.size()}, 1, "after an oversized region");
+
+#if MULTIVERSE_STATS
+    // ✅ Answers go back on the interface that asked
+    Bytes request = usb_message(CommandConfig::STATS);
+    host::usb_receive(true, request.data(), request.size());
+    usb->poll();
+    check(host::usb_sent(true).compare(0, 2, "{\"") == 0, "stat answered on the vendor interface");
+#endif
+
+    std::printf("usb_test: %d failure(s)\n", failures);
+    return failures ? 1 : 0;
+}
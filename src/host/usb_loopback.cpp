@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include "host.hpp"
+#include "tusb.h"
+
+// TinyUSB's device API over in-memory endpoint FIFOs, so the USB handler runs on the host: the test feeds
+// what a host would send with host::usb_receive and reads the replies with host::usb_sent. There is no
+// enumeration, both interfaces are always mounted. Reads come in whatever pieces were queued, cut to the
+// buffer they are read into, like tud_*_read draining a FIFO that filled up packet by packet.
+
+struct Endpoint {
+    std::deque<uint8_t> received;
+    std::string sent;
+};
+
+static std::mutex endpoints_lock;
+static Endpoint cdc;
+static Endpoint vendor;
+
+void host::usb_receive(bool on_vendor, const uint8_t *data, size_t len) {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    Endpoint &endpoint = on_vendor ? vendor : cdc;
+    endpoint.received.insert(endpoint.received.end(), data, data + len);
+}
+
+std::string host::usb_sent(bool on_vendor) {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    Endpoint &endpoint = on_vendor ? vendor : cdc;
+    std::string sent;
+    sent.swap(endpoint.sent);
+    return sent;
+}
+
+static uint32_t read(Endpoint &endpoint, void *buffer, uint32_t bufsize) {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    uint32_t len = std::min<size_t>(bufsize, endpoint.received.size());
+    std::copy_n(endpoint.received.begin(), len, static_cast<uint8_t *>(buffer));
+    endpoint.received.erase(endpoint.received.begin(), endpoint.received.begin() + len);
+    return len;
+}
+
+static uint32_t write(Endpoint &endpoint, const void *buffer, uint32_t bufsize) {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    endpoint.sent.append(static_cast<const char *>(buffer), bufsize);
+    return bufsize;
+}
+
+bool tusb_init() {
+    return true;
+}
+
+void tud_task() {
+}
+
+bool tud_cdc_connected() {
+    return true;
+}
+
+uint32_t tud_cdc_available() {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    return cdc.received.size();
+}
+
+uint32_t tud_cdc_read(void *buffer, uint32_t bufsize) {
+    return read(cdc, buffer, bufsize);
+}
+
+uint32_t tud_cdc_write(const void *buffer, uint32_t bufsize) {
+    return write(cdc, buffer, bufsize);
+}
+
+uint32_t tud_cdc_write_flush() {
+    return 0;
+}
+
+bool tud_vendor_mounted() {
+    return true;
+}
+
+uint32_t tud_vendor_available() {
+    std::lock_guard<std::mutex> guard(endpoints_lock);
+    return vendor.received.size();
+}
+
+uint32_t tud_vendor_read(void *buffer, uint32_t bufsize) {
+    return read(vendor, buffer, bufsize);
+}
+
+uint32_t tud_vendor_write(const void *buffer, uint32_t bufsize) {
+    return write(vendor, buffer, bufsize);
+}
+
+uint32_t tud_vendor_write_flush() {
+    return 0;
+}
+
+// ✅ What cdc_uart.cpp and get_serial.cpp provide on the device
+char usb_serial[] = "0000000000000000";
+
+void usb_serial_init() {
+}
+
+uint cdc_task(uint8_t *buf, size_t buf_len) {
+    return tud_cdc_connected() && tud_cdc_available() ? tud_cdc_read(buf, buf_len) : 0;
+}
@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include "core0.hpp"
+#include "host.hpp"
+#include "libraries/interstate75/interstate75.hpp"
+
+static unsigned refresh_hz = 120;
+static std::string frame_directory;  // Empty while frames aren't dumped
+static unsigned frames_dumped = 0;
+
+void host::set_refresh_rate(unsigned hz) {
+    refresh_hz = std::max(hz, 1u);
+}
+
+void host::dump_frames(const std::string &directory) {
+    frame_directory = directory;
+}
+
+namespace pimoroni {
+    // Gamma 2.2 over the 10 bit range
+    const uint16_t GAMMA_10BIT[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 2, 2,
+        2, 3, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 9, 9, 10,
+        11, 11, 12, 13, 14, 15, 16, 16, 17, 18, 19, 20, 21, 23, 24, 25,
+        26, 27, 28, 30, 31, 32, 34, 35, 36, 38, 39, 41, 42, 44, 46, 47,
+        49, 51, 52, 54, 56, 58, 60, 61, 63, 65, 67, 69, 71, 73, 76, 78,
+        80, 82, 84, 87, 89, 91, 94, 96, 98, 101, 103, 106, 109, 111, 114, 117,
+        119, 122, 125, 128, 130, 133, 136, 139, 142, 145, 148, 151, 155, 158, 161, 164,
+        167, 171, 174, 177, 181, 184, 188, 191, 195, 198, 202, 206, 209, 213, 217, 221,
+        225, 228, 232, 236, 240, 244, 248, 252, 257, 261, 265, 269, 274, 278, 282, 287,
+        291, 295, 300, 304, 309, 314, 318, 323, 328, 333, 337, 342, 347, 352, 357, 362,
+        367, 372, 377, 382, 387, 393, 398, 403, 408, 414, 419, 425, 430, 436, 441, 447,
+        452, 458, 464, 470, 475, 481, 487, 493, 499, 505, 511, 517, 523, 529, 535, 542,
+        548, 554, 561, 567, 573, 580, 586, 593, 599, 606, 613, 619, 626, 633, 640, 647,
+        653, 660, 667, 674, 681, 689, 696, 703, 710, 717, 725, 732, 739, 747, 754, 762,
+        769, 777, 784, 792, 800, 807, 815, 823, 831, 839, 847, 855, 863, 871, 879, 887,
+        895, 903, 912, 920, 928, 937, 945, 954, 962, 971, 979, 988, 997, 1005, 1014, 1023,
+    };
+
+    // What the panel shows: each 10 bit level back to the lowest 8 bit value driven at it, so frames
+    // round-trip at full brightness except where dark values share a level
+    static uint8_t to_8bit(uint32_t level) {
+        return std::min<size_t>(std::lower_bound(GAMMA_10BIT, GAMMA_10BIT + 256, level) - GAMMA_10BIT, 255);
+    }
+
+    static void dump_frame(const Hub75 &panel) {
+        // ✅ Slot (0 = bits 0-9, 1 = bits 10-19, 2 = bits 20-29) of R, G and B for each colour order, as in matrix.cpp
+        static const uint8_t slots[6][3] = {
+            {0, 1, 2}, // RGB
+            {0, 2, 1}, // RBG
+            {1, 0, 2}, // GRB
+            {2, 0, 1}, // GBR
+            {1, 2, 0}, // BRG
+            {2, 1, 0}  // BGR
+        };
+        const uint8_t *slot = slots[static_cast<int>(panel.color_order)];
+
+        std::vector<uint8_t> rgb;
+        rgb.reserve(panel.width * panel.height * 3);
+        for (uint y = 0; y < panel.height; y++) {
+            // ✅ The top and bottom half of the panel are interleaved, see Hub75::set_color
+            const Pixel *row = panel.back_buffer + (y % (panel.height / 2)) * panel.width * 2 + (y >= panel.height / 2 ? 1 : 0);
+            for (uint x = 0; x < panel.width; x++) {
+                uint32_t color = row[x * 2].color;
+                for (int channel = 0; channel < 3; channel++) {
+                    rgb.push_back(to_8bit((color >> (10 * slot[channel])) & 0x3ff));
+                }
+            }
+        }
+
+        // ✅ Written under a temporary name and renamed, whatever watches the directory never sees half a frame
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame_%06u.ppm", frames_dumped++);
+        std::string path = frame_directory + "/" + name;
+        std::string partial = path + ".part";
+
+        FILE *file = std::fopen(partial.c_str(), "wb");
+        if (!file) {
+            std::perror(partial.c_str());
+            return;
+        }
+        std::fprintf(file, "P6\n%u %u\n255\n", panel.width, panel.height);
+        std::fwrite(rgb.data(), 1, rgb.size(), file);
+        std::fclose(file);
+        std::rename(partial.c_str(), path.c_str());
+    }
+
+    Hub75::Hub75(uint width, uint height, Pixel *buffer, PanelType panel_type, bool inverted_stb, COLOR_ORDER color_order)
+        : width(width), height(height), back_buffer(buffer), panel_type(panel_type), inverted_stb(inverted_stb),
+          color_order(color_order) {
+    }
+
+    void Hub75::start(void (*handler)()) {
+        uint core = get_core_num();  // ✅ The DMA interrupt is serviced by the core that starts the driver
+        std::thread([this, handler, core] {
+            set_core_num(core);
+            using clock = std::chrono::steady_clock;
+            const auto period = std::chrono::microseconds(1000000 / refresh_hz);
+            const Pixel *shown = nullptr;
+            auto next = clock::now();
+
+            while (true) {
+                // ✅ One call per row and bit plane, as the DMA interrupt does, so flips land at the same vblank
+                for (uint i = 0; i < height / 2 * BIT_DEPTH; i++) {
+                    handler();
+                }
+
+                if (back_buffer != shown) {
+                    shown = back_buffer;
+                    if (!frame_directory.empty()) {
+                        dump_frame(*this);
+                    }
+                }
+
+                next += period;
+                auto now = clock::now();
+                if (next < now) {
+                    next = now;  // ✅ Fell behind (dumping, a debugger), don't race to catch up
+                }
+                std::this_thread::sleep_until(next);
+            }
+        }).detach();
+    }
+
+    void Hub75::dma_complete() {
+        if (++bit == BIT_DEPTH) {
+            bit = 0;
+            if (++row == height / 2) {
+                row = 0;
+            }
+        }
+    }
+}
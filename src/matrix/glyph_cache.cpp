@@ -0,0 +1,77 @@
+#include "glyph_cache.hpp"
+#include <algorithm>
+#include "libraries/pico_graphics/pico_graphics.hpp"
+
+using namespace pimoroni;
+
+namespace matrix {
+    bool GlyphCache::build(const std::string& font, int font_height, int scale) {
+        if (font_height * scale > MAX_SIZE) return false;
+
+        // ✅ Draw each glyph on a scratch surface the size of the largest one, keep the pixels that were set
+        std::vector<uint32_t> scratch(MAX_SIZE * MAX_SIZE);
+        PicoGraphics_PenRGB888 canvas(MAX_SIZE, MAX_SIZE, scratch.data());
+        canvas.set_font(font);
+
+        std::vector<uint32_t> rasterised(GLYPHS * font_height * scale);
+        uint8_t widths[GLYPHS];
+        for (int glyph = 0; glyph < GLYPHS; glyph++) {
+            std::string text(1, static_cast<char>(FIRST + glyph));
+            int width = canvas.measure_text(text, scale, 1, false);
+            if (width > MAX_SIZE + scale) return false;  // ✅ The letter spacing may hang over, the glyph may not
+            widths[glyph] = width;
+
+            canvas.set_pen(0, 0, 0);
+            canvas.clear();
+            canvas.set_pen(255, 255, 255);
+            canvas.text(text, Point(0, 0), MAX_SIZE, scale, 0, 1, false);
+
+            for (int y = 0; y < font_height * scale; y++) {
+                uint32_t bits = 0;
+                for (int x = 0; x < MAX_SIZE; x++) {
+                    if (scratch[y * MAX_SIZE + x] & 0xffffff) bits |= 1u << x;
+                }
+                rasterised[glyph * font_height * scale + y] = bits;
+            }
+        }
+
+        rows.swap(rasterised);
+        std::copy(widths, widths + GLYPHS, advances);
+        glyph_height = font_height * scale;
+        return true;
+    }
+
+    int GlyphCache::measure(std::string_view text) const {
+        int width = 0;
+        for (char c : text) {
+            width += advance(c);
+        }
+        return width;
+    }
+
+    int GlyphCache::draw(uint32_t* surface, int width, int height, int x, int y, std::string_view text,
+                         uint32_t colour) const {
+        const int first_row = std::max(0, -y);
+        const int last_row = std::min(glyph_height, height - y);
+
+        for (char c : text) {
+            int glyph = index(c);
+            if (x < width && x + MAX_SIZE > 0 && first_row < last_row) {
+                // ✅ Clip the columns once per glyph, then only visit the pixels that are set
+                uint32_t keep = ~0u;
+                if (x < 0) keep &= ~0u << -x;
+                if (width - x < MAX_SIZE) keep &= (1u << (width - x)) - 1;
+
+                const uint32_t* glyph_rows = &rows[glyph * glyph_height];
+                for (int row = first_row; row < last_row; row++) {
+                    uint32_t* line = surface + (y + row) * width;
+                    for (uint32_t bits = glyph_rows[row] & keep; bits; bits &= bits - 1) {
+                        line[x + __builtin_ctz(bits)] = colour;
+                    }
+                }
+            }
+            x += advances[glyph];
+        }
+        return x;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace matrix {
+    // A font rasterised once into packed rows of 1 bit per pixel, so text is set straight into an
+    // RGBX8888 surface like `buffer` instead of going through a PicoGraphics text pass. Covers printable
+    // ASCII, anything else is drawn as '?'. Glyphs are at most MAX_SIZE pixels each way, which leaves
+    // room to scale an 8 pixel bitmap font up to 4 times.
+    class GlyphCache {
+    public:
+        static const int FIRST = ' ';
+        static const int LAST = '~';
+        static const int MAX_SIZE = 32;
+
+        // Renders every glyph of `font` (a PicoGraphics font name, `font_height` pixels tall) at `scale`;
+        // false if they would be larger than MAX_SIZE
+        bool build(const std::string& font, int font_height, int scale = 1);
+        bool ready() const { return glyph_height > 0; }
+        int height() const { return glyph_height; }
+        int advance(char c) const { return advances[index(c)]; }  // Width, letter spacing included
+        int measure(std::string_view text) const;
+
+        // Sets the pixels of `text` to `colour`, its top left at x, y on a `width` x `height` surface and
+        // clipped to it. Returns the x after the last character.
+        int draw(uint32_t* surface, int width, int height, int x, int y, std::string_view text, uint32_t colour) const;
+
+    private:
+        static const int GLYPHS = LAST - FIRST + 1;
+
+        static int index(char c) {
+            return c >= FIRST && c <= LAST ? c - FIRST : '?' - FIRST;
+        }
+
+        int glyph_height = 0;
+        uint8_t advances[GLYPHS] = {};
+        std::vector<uint32_t> rows;  // glyph_height rows per glyph, bit n set for a pixel in column n
+    };
+}
@@ -1,8 +1,15 @@
 #include "matrix.hpp"
 #include "buildinfo.h"
-#include <deque>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include "config_storage.hpp"
+#include "glyph_cache.hpp"
+#include "perf.hpp"
+#include "trace.hpp"
+#include "spsc_queue.hpp"
+#include "pico/multicore.h"
+#include "zlib.h"
 #include <unordered_map>
 
 using namespace pimoroni;
@@ -12,14 +19,515 @@ namespace matrix {
     PicoGraphics_PenRGB888 graphics(WIDTH, HEIGHT, &buffer);
     Hub75* hub75 = nullptr;
 
+    // ✅ Front/back pair of Hub75 buffers, the front one is scanned out by DMA
+    static Pixel frame_buffers[2][WIDTH * HEIGHT];
+    static volatile uint8_t front_index = 0;
+    static volatile bool flip_pending = false;
+    static volatile uint64_t flip_deadline = 0;  // ✅ time_us_64() the pending flip waits for, 0 for the next vblank
+    static PresentStats timed_stats;
+    static bool back_ready = false;
+    static uint64_t dirty_rows[2] = {ALL_ROWS, ALL_ROWS};  // Rows of `buffer` each Hub75 buffer is missing
+
+    // ✅ Gamma corrected and brightness scaled channel values, pre-shifted into their Hub75 colour order slot
+    static uint32_t lut_r[256];
+    static uint32_t lut_g[256];
+    static uint32_t lut_b[256];
+    static Hub75::COLOR_ORDER lut_color_order = Hub75::COLOR_ORDER::RGB;
+    static uint8_t lut_brightness = 255;
+
+    // ✅ Per-channel 8 to 10 bit curves the tables above are built from, gamma unless calibrated
+    static uint16_t curves[3][256];
+
+    // ✅ Degrees clockwise the image in `buffer` is turned to fit the panel, and the size it has before that
+    static int rotation = 0;
+    static int view_width = WIDTH;
+    static int view_height = HEIGHT;
+
+    // ✅ Work handed from core 0 (transports) to core 1 (decode, conversion and scan-out)
+    enum class JobType : uint8_t {
+        COMMIT,
+        FLIP,
+        PRESENT,
+        REDRAW,
+        INFLATE,
+        INFLATE_DELTA
+    };
+
+    struct FrameJob {
+        JobType type;
+        bool present;
+        size_t size;
+        uint64_t rows;
+        PixelFormat format;
+        uint64_t present_at;  // ✅ FLIP only: time_us_64() to present at, 0 for as soon as possible
+    };
+
+    static SpscQueue<FrameJob, 8> jobs;
+    static std::atomic<uint32_t> jobs_submitted{0};
+    static std::atomic<uint32_t> jobs_completed{0};
+    static JobType last_submitted = JobType::COMMIT;  // ✅ Only touched with interrupts disabled
+
+    // ✅ Compressed bytes stream through this ring and are inflated by core 1 as they arrive
+    const size_t INFLATE_RING_SIZE = 8 * 1024;
+    static SpscByteRing<INFLATE_RING_SIZE> inflate_ring;
+    static std::atomic<bool> inflate_aborted{false};
+    static std::atomic<bool> keyframe_needed{false};  // ✅ A frame failed to inflate, `buffer` is no base for deltas
+    static z_stream zstream;
+    static uint8_t inflate_chunk[1024];  // ✅ Inflated bytes on their way to being XORed or unpacked into `buffer`
+    static PixelWriter inflate_writer;
+
+    // ✅ Colours of the indexed pixel formats, in the native layout of `buffer`
+    static uint32_t palette[PALETTE_SIZE];
+
     const int FONT_HEIGHT = 8;
     const std::string FONT = "bitmap8";
-    const int MAX_LINES = HEIGHT / FONT_HEIGHT;
 
-    static std::deque<char> text_buffer; // Store characters dynamically
+    // ✅ Drawn over `buffer` while it is converted, in its layout with the padding byte as alpha
+    static uint32_t overlay[WIDTH * HEIGHT];
+    static uint64_t overlay_rows = 0;                   // Rows of `buffer` (as row_mask marks them) it covers
+    static std::atomic<bool> overlay_pending{false};    // ✅ Changed while a frame streamed in, convert everything
+    static std::atomic<bool> overlay_locked{false};     // Held by core 0 drawing into it and core 1 converting
+    static GlyphCache overlay_fonts[OVERLAY_MAX_SCALE];  // Rasterised the first time each scale is used
+
+    // ✅ Core 0 draws into the overlay without waiting for the frame being converted, only for the
+    // conversion itself. Neither core holds it long or with interrupts off; core 0's writers (lwIP
+    // callbacks, USB sessions inside cyw43_arch_lwip_begin) never interrupt one another.
+    class OverlayLock {
+    public:
+        OverlayLock() {
+            while (overlay_locked.exchange(true, std::memory_order_acquire)) {
+                tight_loop_contents();
+            }
+        }
+        ~OverlayLock() { overlay_locked.store(false, std::memory_order_release); }
+    };
+
+    const int CONSOLE_LINES = std::max(WIDTH, HEIGHT) / FONT_HEIGHT;  // Lines on screen when rotated sideways
+
+    // ✅ Text printed to the console, a ring of the lines that can be on screen; print() continues the newest
+    static std::string console_lines[CONSOLE_LINES];
+    static uint32_t console_total = 0;     // Lines started since the console was cleared
+    static int console_width = 0;          // Pixels taken on the newest line
+    static bool console_newline = true;    // The newest line has ended, the next character starts another
+    static std::atomic<bool> console_shown{false};  // ✅ `buffer` still holds the console as print() left it
+    static GlyphCache console_font;        // ✅ FONT rasterised once, the console is drawn from it
 
     void __isr dma_complete() {
-        if (hub75) hub75->dma_complete();
+        if (!hub75) return;
+
+        // ✅ Swap buffers after the last row of the last bit plane, so a frame is never torn
+        if (flip_pending && hub75->row == hub75->height / 2 - 1 && hub75->bit == BIT_DEPTH - 1) {
+            uint64_t now = flip_deadline ? time_us_64() : 0;
+            if (now >= flip_deadline) {
+                front_index ^= 1;
+                hub75->back_buffer = frame_buffers[front_index];
+                flip_pending = false;
+
+                if (flip_deadline) {
+                    uint32_t late = now - flip_deadline;
+                    timed_stats.presents++;
+                    timed_stats.late_us = late;
+                    timed_stats.max_late_us = std::max(timed_stats.max_late_us, late);
+                    trace::log(trace::Event::FLIP, late, 1);
+                } else {
+                    trace::log(trace::Event::FLIP, 0, 0);
+                }
+            }
+        }
+
+        hub75->dma_complete();
+    }
+
+    void build_luts(Hub75::COLOR_ORDER color_order, uint8_t brightness) {
+        // Slot (0 = bits 0-9, 1 = bits 10-19, 2 = bits 20-29) of R, G and B for each colour order,
+        // matching what Hub75::set_pixel does
+        static const uint8_t slots[6][3] = {
+            {0, 1, 2}, // RGB
+            {0, 2, 1}, // RBG
+            {1, 0, 2}, // GRB
+            {2, 0, 1}, // GBR
+            {1, 2, 0}, // BRG
+            {2, 1, 0}  // BGR
+        };
+        const uint8_t* slot = slots[static_cast<int>(color_order)];
+
+        for (int v = 0; v < 256; v++) {
+            lut_r[v] = static_cast<uint32_t>(curves[0][v] * brightness / 255) << (10 * slot[0]);
+            lut_g[v] = static_cast<uint32_t>(curves[1][v] * brightness / 255) << (10 * slot[1]);
+            lut_b[v] = static_cast<uint32_t>(curves[2][v] * brightness / 255) << (10 * slot[2]);
+        }
+        lut_color_order = color_order;
+        lut_brightness = brightness;
+    }
+
+    // Wire calibration (see set_calibration) into curves, nullptr for plain gamma correction
+    static void load_curves(const uint8_t* data) {
+        for (int channel = 0; channel < 3; channel++) {
+            for (int v = 0; v < 256; v++) {
+                if (data) {
+                    const uint8_t* entry = data + (channel * 256 + v) * 2;
+                    curves[channel][v] = std::min(entry[0] | (entry[1] << 8), 1023);
+                } else {
+                    curves[channel][v] = GAMMA_10BIT[v];
+                }
+            }
+        }
+    }
+
+    static bool sideways() {
+        return rotation == 90 || rotation == 270;
+    }
+
+    static inline uint32_t to_hub75(uint32_t col) {
+        return lut_r[(col >> 16) & 0xff] | lut_g[(col >> 8) & 0xff] | lut_b[col & 0xff];
+    }
+
+    // An overlay pixel over a frame pixel, by the overlay's alpha
+    static inline uint32_t composite(uint32_t col, uint32_t over) {
+        uint32_t alpha = over >> 24;
+        if (alpha == 0) return col;
+        if (alpha == 255) return over;
+
+        // ✅ Red and blue are blended in one multiply, their 8 spare bits in between keep them apart
+        uint32_t rb = ((over & 0xff00ff) * alpha + (col & 0xff00ff) * (255 - alpha)) >> 8;
+        uint32_t g = ((over & 0x00ff00) * alpha + (col & 0x00ff00) * (255 - alpha)) >> 8;
+        return (rb & 0xff00ff) | (g & 0x00ff00);
+    }
+
+    template<bool OVERLAID>
+    static inline uint32_t source(const uint32_t* p, const uint32_t* o, int x) {
+        return OVERLAID ? composite(p[x], o[x]) : p[x];
+    }
+
+    // Hub75 interleaves the top and bottom half of the panel, see Hub75::set_color
+    static inline Pixel* panel_row(Pixel* target, int y) {
+        return target + (y % (HEIGHT / 2)) * WIDTH * 2 + (y >= HEIGHT / 2 ? 1 : 0);
+    }
+
+    // ✅ A quarter turn: walk `buffer` in tiles so each one reads a few short runs of a few rows
+    // and writes a few neighbouring panel rows, instead of striding the whole panel per pixel
+    template<bool OVERLAID>
+    static void convert_sideways(Pixel* target) {
+        const int TILE = 8;
+        static_assert(WIDTH % TILE == 0 && (HEIGHT / 2) % TILE == 0, "Tiles must not straddle panel halves");
+
+        const uint32_t* src = reinterpret_cast<const uint32_t*>(buffer);
+        for (int ty = 0; ty < view_height; ty += TILE) {
+            for (int tx = 0; tx < view_width; tx += TILE) {
+                for (int y = ty; y < ty + TILE; y++) {
+                    const uint32_t* p = src + y * view_width + tx;
+                    const uint32_t* o = overlay + y * view_width + tx;
+                    if (rotation == 90) {
+                        // (x, y) lands on panel column view_height - 1 - y, row x
+                        Pixel* dst = panel_row(target, tx) + (view_height - 1 - y) * 2;
+                        for (int x = 0; x < TILE; x++) {
+                            dst[x * WIDTH * 2].color = to_hub75(source<OVERLAID>(p, o, x));
+                        }
+                    } else {
+                        // (x, y) lands on panel column y, row view_width - 1 - x
+                        Pixel* dst = panel_row(target, view_width - 1 - tx) + y * 2;
+                        for (int x = 0; x < TILE; x++) {
+                            dst[-x * WIDTH * 2].color = to_hub75(source<OVERLAID>(p, o, x));
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    template<bool OVERLAID>
+    static void convert_row(Pixel* target, int y) {
+        const uint32_t* p = reinterpret_cast<const uint32_t*>(buffer) + y * WIDTH;
+        const uint32_t* o = overlay + y * WIDTH;
+
+        if (rotation == 180) {
+            Pixel* dst = panel_row(target, HEIGHT - 1 - y) + (WIDTH - 1) * 2;
+            for (int x = 0; x < WIDTH; x++) {
+                dst[-x * 2].color = to_hub75(source<OVERLAID>(p, o, x));
+            }
+        } else {
+            Pixel* dst = panel_row(target, y);
+            for (int x = 0; x < WIDTH; x++) {
+                dst[x * 2].color = to_hub75(source<OVERLAID>(p, o, x));
+            }
+        }
+    }
+
+    void convert_rows(Pixel* target, uint64_t rows) {
+        // ✅ Rows the overlay leaves alone take the plain path, without a blend per pixel
+        const uint64_t overlaid = overlay_rows;
+
+        if (sideways()) {
+            // ✅ Every row of `buffer` touches every panel row
+            if (overlaid) {
+                convert_sideways<true>(target);
+            } else {
+                convert_sideways<false>(target);
+            }
+            return;
+        }
+
+        while (rows) {
+            int y = __builtin_ctzll(rows);
+            rows &= rows - 1;
+
+            if (overlaid >> y & 1) {
+                convert_row<true>(target, y);
+            } else {
+                convert_row<false>(target, y);
+            }
+        }
+    }
+
+    int width() {
+        return view_width;
+    }
+
+    int height() {
+        return view_height;
+    }
+
+    uint64_t row_mask(int first, int count) {
+        int begin = std::max(first, 0);
+        int end = std::min(first + count, view_height);
+        if (begin >= end) return 0;
+        if (sideways()) return ALL_ROWS;
+
+        uint64_t mask = 0;
+        for (int row = begin; row < end; row++) {
+            mask |= 1ull << row;
+        }
+        return mask;
+    }
+
+    void convert_back_buffer(uint64_t rows) {
+        // ✅ The back buffer is still queued for display, wait for the vblank to take it
+        while (flip_pending) {
+            tight_loop_contents();
+        }
+
+        // ✅ The overlay changed without waiting for the frame that was streaming in, it may cover any row
+        if (overlay_pending.exchange(false, std::memory_order_acquire)) {
+            rows = ALL_ROWS;
+        }
+
+        // ✅ Both buffers miss the new rows; the back one also catches up on rows changed while it was in front
+        dirty_rows[0] |= rows;
+        dirty_rows[1] |= rows;
+
+        uint8_t back = front_index ^ 1;
+        trace::log(trace::Event::COMMIT, dirty_rows[back], dirty_rows[back] >> 32);
+        {
+            perf::Scope timer(perf::Timer::CONVERT);
+            OverlayLock lock;
+            convert_rows(frame_buffers[back], dirty_rows[back]);
+        }
+        dirty_rows[back] = 0;
+        back_ready = true;
+    }
+
+    void flip_back_buffer(uint64_t at = 0) {
+        if (!back_ready) return;
+
+        back_ready = false;
+        flip_deadline = at;
+        flip_pending = true;
+    }
+
+    // XORs `len` delta bytes into `buffer` at `offset` and returns the rows that actually changed
+    uint64_t xor_into_buffer(size_t offset, const uint8_t* delta, size_t len) {
+        const size_t row_bytes = view_width * 4;
+        uint64_t rows = 0;
+
+        while (len > 0) {
+            size_t take = std::min(len, row_bytes - offset % row_bytes);
+            uint8_t* dst = buffer + offset;
+            uint8_t changed = 0;
+            for (size_t i = 0; i < take; i++) {
+                changed |= delta[i];
+                dst[i] ^= delta[i];
+            }
+            if (changed) rows |= row_mask(offset / row_bytes, 1);
+
+            offset += take;
+            delta += take;
+            len -= take;
+        }
+        return rows;
+    }
+
+    // Inflates `job.size` compressed bytes from inflate_ring, consuming them in place as core 0 writes
+    // them. Plain frames are inflated straight into `buffer`; delta frames go through inflate_chunk
+    // and are XORed onto the previous frame, other wire formats are unpacked from it. `rows`
+    // receives the rows that changed. All bytes are drained even if the stream turns out to be
+    // corrupt, so the producer never blocks on a full ring. A stream that fails partway leaves part
+    // of it in `buffer`, so deltas are refused from then on until a keyframe lands.
+    bool inflate_stream(const FrameJob& job, uint64_t& rows) {
+        const bool delta = job.type == JobType::INFLATE_DELTA;
+        const bool direct = !delta && job.format == PixelFormat::RGBX8888;
+
+        int result = inflateReset(&zstream);
+        zstream.next_out = buffer;
+        zstream.avail_out = BUFFER_SIZE;
+        size_t out = 0;
+        rows = delta ? 0 : ALL_ROWS;
+        if (!delta && !direct) {
+            inflate_writer.begin(0, 0, view_width, view_height, job.format);
+        }
+
+        size_t remaining = job.size;
+        uint32_t busy_cycles = 0;  // ✅ Spent inflating, not waiting for the network
+        while (remaining > 0) {
+            const uint8_t* chunk;
+            size_t available = inflate_ring.peek(chunk);
+            if (available == 0) {
+                if (inflate_aborted.load(std::memory_order_acquire)) {
+                    inflate_ring.clear();
+                    perf::record(perf::Timer::INFLATE, busy_cycles);
+                    keyframe_needed.store(true, std::memory_order_relaxed);
+                    return false;
+                }
+                tight_loop_contents();
+                continue;
+            }
+            available = std::min(available, remaining);
+
+            if (result == Z_OK) {
+                uint32_t start = perf::cycles();
+                zstream.next_in = const_cast<Bytef*>(chunk);
+                zstream.avail_in = available;
+
+                if (direct) {
+                    result = ::inflate(&zstream, Z_NO_FLUSH);
+                } else {
+                    do {
+                        zstream.next_out = inflate_chunk;
+                        zstream.avail_out = std::min(sizeof(inflate_chunk), BUFFER_SIZE - out);
+                        result = ::inflate(&zstream, Z_NO_FLUSH);
+
+                        size_t produced = zstream.next_out - inflate_chunk;
+                        if (delta) {
+                            rows |= xor_into_buffer(out, inflate_chunk, produced);
+                        } else {
+                            inflate_writer.write(inflate_chunk, produced);
+                        }
+                        out += produced;
+                    } while (result == Z_OK && zstream.avail_out == 0 && out < BUFFER_SIZE);
+                }
+
+                // ✅ No progress possible with this chunk (e.g. the trailer is still in flight), not an error
+                if (result == Z_BUF_ERROR) result = Z_OK;
+                busy_cycles += perf::cycles() - start;
+            }
+
+            inflate_ring.consume(available);
+            remaining -= available;
+        }
+
+        perf::record(perf::Timer::INFLATE, busy_cycles);
+        trace::log(trace::Event::INFLATE, job.size, result == Z_STREAM_END);
+        if (result != Z_STREAM_END) {
+            perf::add(perf::Counter::INFLATE_FAILURES);
+            keyframe_needed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        if (!delta) keyframe_needed.store(false, std::memory_order_relaxed);
+        return true;
+    }
+
+    void run_job(const FrameJob& job) {
+        switch (job.type) {
+            case JobType::COMMIT:
+                convert_back_buffer(job.rows);
+                break;
+            case JobType::FLIP:
+                flip_back_buffer(job.present_at);
+                break;
+            case JobType::PRESENT:
+                convert_back_buffer(job.rows);
+                flip_back_buffer();
+                break;
+            case JobType::REDRAW: {
+                // ✅ A committed frame waiting for its flip (sync, or a presentation time) takes the change along
+                // and is still shown when it was meant to be, never early
+                bool waiting = back_ready;
+                convert_back_buffer(job.rows);
+                if (!waiting) flip_back_buffer();
+                break;
+            }
+            case JobType::INFLATE:
+            case JobType::INFLATE_DELTA: {
+                uint64_t rows;
+                if (!inflate_stream(job, rows)) {
+                    break;  // Keep showing the previous frame
+                }
+                convert_back_buffer(rows);  // ✅ Deltas only re-convert rows with a non-zero XOR
+                if (job.present) flip_back_buffer();
+                break;
+            }
+        }
+    }
+
+    void core1_main() {
+        multicore_lockout_victim_init();  // ✅ Lets core 0 park this core while it writes flash
+        perf::start_core();
+
+        // ✅ Allocated once; inflateReset keeps the state and window between frames
+        inflateInit(&zstream);
+
+        // ✅ Started here so the Hub75 DMA interrupt is serviced by core 1 as well
+        hub75->start(dma_complete);
+
+        FrameJob job;
+        while (true) {
+            if (!jobs.pop(job)) {
+                tight_loop_contents();
+                continue;
+            }
+            run_job(job);
+            jobs_completed.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+    void submit(const FrameJob& job) {
+        if (!hub75) return;
+
+        // Core 0 has two producers (thread and lwIP interrupt context), keep them from interleaving. A full
+        // queue is waited out with interrupts enabled, core 1 may be inflating bytes only they can deliver.
+        while (true) {
+            uint32_t ints = save_and_disable_interrupts();
+
+            // ✅ Nothing was converted since the last flip, another one would find no frame to present. While
+            // a zipped frame streams in other connections can only queue flips, so this keeps room for it.
+            if (job.type == JobType::FLIP && last_submitted == JobType::FLIP) {
+                restore_interrupts(ints);
+                return;
+            }
+
+            bool queued = jobs.push(job);
+            if (queued) {
+                last_submitted = job.type;
+                jobs_submitted.fetch_add(1, std::memory_order_relaxed);
+            }
+            restore_interrupts(ints);
+
+            if (queued) return;
+            tight_loop_contents();
+        }
+    }
+
+    void acquire() {
+        if (jobs_completed.load(std::memory_order_acquire) == jobs_submitted.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        uint32_t start = time_us_32();
+        uint32_t start_cycles = perf::cycles();
+        while (jobs_completed.load(std::memory_order_acquire) != jobs_submitted.load(std::memory_order_relaxed)) {
+            tight_loop_contents();
+        }
+        perf::record(perf::Timer::ACQUIRE, perf::cycles() - start_cycles);
+        trace::log(trace::Event::ACQUIRE, time_us_32() - start);
     }
 
     void init(KVStore& kvStore) {  // ✅ Pass `kvStore` to `init`
@@ -67,10 +575,30 @@ namespace matrix {
 
 
 
-            hub75 = new Hub75(WIDTH, HEIGHT, nullptr, PANEL_GENERIC, false, color_order);
+            // ✅ Both are applied while converting to the Hub75 layout, the transports never see them
+            int degrees = std::atoi(kvStore.getParam("rotation").c_str());
+            rotation = degrees == 90 || degrees == 180 || degrees == 270 ? degrees : 0;
+            if (sideways()) {
+                view_width = HEIGHT;
+                view_height = WIDTH;
+                graphics.set_dimensions(view_width, view_height);
+            }
+
+            std::string brightness = kvStore.getParam("brightness");
+            static uint8_t calibration[CALIBRATION_SIZE];
+            load_curves(kvStore.loadCalibration(calibration, sizeof(calibration)) ? calibration : nullptr);
+            build_luts(color_order, brightness.empty() ? 255 : std::clamp(std::atoi(brightness.c_str()), 0, 255));
+            for (size_t i = 0; i < PALETTE_SIZE; i++) {
+                palette[i] = i * 0x010101;  // ✅ Grey ramp until a palette is uploaded
+            }
+            hub75 = new Hub75(WIDTH, HEIGHT, frame_buffers[front_index], PANEL_GENERIC, false, color_order);
         }
 
-        hub75->start(dma_complete);
+        static bool core1_running = false;
+        if (!core1_running) {
+            multicore_launch_core1(core1_main);
+            core1_running = true;
+        }
         print(std::to_string(WIDTH) + "x" + std::to_string(HEIGHT) + " - " + BOARD_NAME + "\n" + PICO_PLATFORM + "\n" + BUILD_NUMBER);
     }
 
@@ -81,46 +609,351 @@ namespace matrix {
     }
 
 
-    void update() {
-        if (hub75) hub75->update(&graphics);
+    void commit(uint64_t rows) {
+        submit({JobType::COMMIT, false, 0, rows, PixelFormat::RGBX8888, 0});
     }
 
-    int line_count() {
-        int line_count = 0;
-        for (char c : text_buffer) {
-            if (c == '\n') {
-                line_count++;
+    void flip() {
+        submit({JobType::FLIP, false, 0, 0, PixelFormat::RGBX8888, 0});
+    }
+
+    void flip_at(uint64_t time_us) {
+        submit({JobType::FLIP, false, 0, 0, PixelFormat::RGBX8888, time_us});
+    }
+
+    PresentStats present_stats() {
+        return timed_stats;
+    }
+
+    void update(uint64_t rows) {
+        submit({JobType::PRESENT, true, 0, rows, PixelFormat::RGBX8888, 0});
+    }
+
+    void redraw(uint64_t rows) {
+        submit({JobType::REDRAW, true, 0, rows, PixelFormat::RGBX8888, 0});
+    }
+
+    void inflate_begin(size_t compressed_size, bool present, bool delta, PixelFormat format) {
+        inflate_aborted.store(false, std::memory_order_relaxed);
+        console_shown.store(false, std::memory_order_relaxed);
+        submit({delta ? JobType::INFLATE_DELTA : JobType::INFLATE, present, compressed_size, ALL_ROWS, format, 0});
+    }
+
+    void set_brightness(int brightness) {
+        if (!hub75) return;
+
+        acquire();  // ✅ Core 1 may be converting with the current tables
+        build_luts(lut_color_order, std::clamp(brightness, 0, 255));
+        redraw();   // ✅ Re-convert everything so both Hub75 buffers pick it up
+    }
+
+    bool set_calibration(KVStore& kvStore, const uint8_t* data, size_t len) {
+        if (!hub75 || (len != 0 && len != CALIBRATION_SIZE)) return false;
+
+        acquire();
+        load_curves(len ? data : nullptr);
+        build_luts(lut_color_order, lut_brightness);
+        redraw();   // ✅ A frame waiting for its flip is converted again, not shown early
+        return kvStore.storeCalibration(data, len);
+    }
+
+    void set_palette(const uint8_t* data, size_t len) {
+        acquire();  // ✅ Core 1 may be expanding an indexed frame
+        std::memcpy(palette, data, std::min(len / 4, PALETTE_SIZE) * 4);
+    }
+
+    // RGB565 to RGBX8888 with the top bits replicated into the low ones, split per input byte so the
+    // table stays small: blue and the low green bits live in the low byte, red and the rest in the high one
+    struct Rgb565Lut {
+        uint32_t low[256];
+        uint32_t high[256];
+
+        constexpr Rgb565Lut() : low(), high() {
+            for (uint32_t v = 0; v < 256; v++) {
+                uint32_t b5 = v & 0x1f;
+                uint32_t g_low = v >> 5;   // Green bits 0-2
+                uint32_t g_high = v & 0x07; // Green bits 3-5
+                uint32_t r5 = v >> 3;
+
+                low[v] = ((b5 << 3) | (b5 >> 2)) | (g_low << 2) << 8;
+                high[v] = ((r5 << 3) | (r5 >> 2)) << 16 | ((g_high << 5) | (g_high >> 1)) << 8;
             }
         }
-        return line_count;
+    };
+    static constexpr Rgb565Lut rgb565_lut;
+
+    static void unpack_rgb888(uint32_t* dst, const uint8_t* src, size_t count) {
+        // ✅ Four pixels from three (possibly unaligned) words at a time
+        for (; count >= 4; count -= 4, src += 12, dst += 4) {
+            uint32_t w[3];
+            std::memcpy(w, src, sizeof(w));
+            dst[0] = w[0] & 0xffffff;
+            dst[1] = (w[0] >> 24) | ((w[1] << 8) & 0xffffff);
+            dst[2] = (w[1] >> 16) | ((w[2] << 16) & 0xffffff);
+            dst[3] = w[2] >> 8;
+        }
+        for (; count > 0; count--, src += 3) {
+            *dst++ = src[0] | (src[1] << 8) | (src[2] << 16);
+        }
+    }
+
+    static void unpack_rgb565(uint32_t* dst, const uint8_t* src, size_t count) {
+        for (; count > 0; count--, src += 2) {
+            *dst++ = rgb565_lut.low[src[0]] | rgb565_lut.high[src[1]];
+        }
+    }
+
+    static void unpack_indexed(uint32_t* dst, const uint8_t* src, size_t count) {
+        for (; count > 0; count--) {
+            *dst++ = palette[*src++];
+        }
     }
 
-    void scroll() {
-        // Remove characters up to and including the first '\n' if buffer exceeds max lines
+    void PixelWriter::begin(int x, int y, uint16_t w, uint16_t h, PixelFormat format, uint32_t* landed_map) {
+        this->x = x;
+        this->y = y;
+        this->w = w;
+        this->h = h;
+        this->format = format;
+        switch (format) {
+            case PixelFormat::RGBX8888: bytes_per_pixel = 4; break;
+            case PixelFormat::RGB888:   bytes_per_pixel = 3; break;
+            case PixelFormat::RGB565:   bytes_per_pixel = 2; break;
+            case PixelFormat::INDEX8:
+            case PixelFormat::INDEX4:   bytes_per_pixel = 1; break;  // INDEX4 is split into one index per byte first
+        }
+        pixel = 0;
+        partial_len = 0;
+        landed = 0;
+        this->landed_map = landed_map;
+        if (landed_map) std::memset(landed_map, 0, LANDED_MAP_WORDS * 4);
+        console_shown.store(false, std::memory_order_relaxed);  // ✅ Pixels land on top of the console
+
+        dirty_rows = row_mask(y, h);
+    }
 
-        while (line_count() > MAX_LINES) {
-            while (!text_buffer.empty()) {
-                char c = text_buffer.front();
-                text_buffer.pop_front();
-                if (c == '\n') break;
+    void PixelWriter::write(const uint8_t* data, size_t len) {
+        if (format == PixelFormat::INDEX4) {
+            // ✅ Bytes never straddle pixels here, split them into indices in small batches
+            uint8_t indices[128];
+            while (len > 0) {
+                size_t take = std::min(len, sizeof(indices) / 2);
+                for (size_t i = 0; i < take; i++) {
+                    indices[i * 2] = data[i] >> 4;
+                    indices[i * 2 + 1] = data[i] & 0x0f;
+                }
+                write_pixels(indices, take * 2);
+                data += take;
+                len -= take;
             }
+            return;
+        }
+
+        // ✅ Complete a pixel left over from the previous write first
+        if (partial_len > 0) {
+            size_t take = std::min(len, bytes_per_pixel - partial_len);
+            std::memcpy(partial + partial_len, data, take);
+            partial_len += take;
+            data += take;
+            len -= take;
+
+            if (partial_len < bytes_per_pixel) return;
+            write_pixels(partial, 1);
+            partial_len = 0;
         }
+
+        size_t count = len / bytes_per_pixel;
+        write_pixels(data, count);
+
+        partial_len = len - count * bytes_per_pixel;
+        std::memcpy(partial, data + count * bytes_per_pixel, partial_len);
     }
 
-    void redraw() {
-        std::string text_output(text_buffer.begin(), text_buffer.end());
-        info(text_output);
+    void PixelWriter::seek(size_t offset) {
+        pixel = format == PixelFormat::INDEX4 ? offset * 2 : offset / bytes_per_pixel;
+        partial_len = 0;
+    }
+
+    uint8_t* PixelWriter::window(size_t& len) {
+        if (format != PixelFormat::RGBX8888 || partial_len > 0 || x != 0 || w != view_width ||
+            y < 0 || y >= view_height) {
+            return nullptr;
+        }
+
+        size_t end = static_cast<size_t>(std::min<int>(h, view_height - y)) * w;
+        if (pixel >= end) return nullptr;
+
+        len = std::min(len, (end - pixel) * 4);
+        return buffer + (y * view_width + pixel) * 4;
+    }
+
+    void PixelWriter::wrote_in_place(size_t len) {
+        const uint8_t* start = buffer + (y * view_width + pixel) * 4;
+        size_t count = len / 4;
+        landed += mark_landed(y * view_width + pixel, count);
+        pixel += count;
+
+        // ✅ A pixel cut short is kept aside, write() completes it like one split across two writes
+        partial_len = len - count * 4;
+        std::memcpy(partial, start + count * 4, partial_len);
+    }
+
+    // ✅ Of `count` pixels of `buffer` starting at `first`, how many landed for the first time
+    size_t PixelWriter::mark_landed(size_t first, size_t count) {
+        if (!landed_map) return count;
+
+        size_t fresh = 0;
+        for (size_t end = first + count; first < end;) {
+            size_t bit = first % 32;
+            size_t take = std::min<size_t>(32 - bit, end - first);
+            uint32_t mask = (take == 32 ? ~0u : (1u << take) - 1) << bit;
+            uint32_t& word = landed_map[first / 32];
+            fresh += __builtin_popcount(mask & ~word);
+            word |= mask;
+            first += take;
+        }
+        return fresh;
+    }
+
+    void PixelWriter::write_pixels(const uint8_t* data, size_t count) {
+        const size_t total = static_cast<size_t>(w) * h;
+
+        while (count > 0 && pixel < total) {
+            size_t row = pixel / w;
+            size_t column = pixel % w;
+            size_t take = std::min(count, w - column);
+
+            // ✅ Unpack the part of this row that lands on the panel, clip the rest
+            int panel_y = y + static_cast<int>(row);
+            int panel_x = x + static_cast<int>(column);
+            size_t skip = panel_x < 0 ? std::min<size_t>(take, -panel_x) : 0;
+            panel_x += skip;
+            if (panel_y >= 0 && panel_y < view_height && panel_x < view_width && skip < take) {
+                size_t visible = std::min<size_t>(take - skip, view_width - panel_x);
+                uint32_t* dst = reinterpret_cast<uint32_t*>(buffer) + panel_y * view_width + panel_x;
+                const uint8_t* src = data + skip * bytes_per_pixel;
+
+                switch (format) {
+                    case PixelFormat::RGBX8888:
+                        std::memcpy(dst, src, visible * 4);
+                        break;
+                    case PixelFormat::RGB888:
+                        unpack_rgb888(dst, src, visible);
+                        break;
+                    case PixelFormat::RGB565:
+                        unpack_rgb565(dst, src, visible);
+                        break;
+                    case PixelFormat::INDEX8:
+                    case PixelFormat::INDEX4:
+                        unpack_indexed(dst, src, visible);
+                        break;
+                }
+                landed += mark_landed(panel_y * view_width + panel_x, visible);
+            }
+
+            pixel += take;
+            data += take * bytes_per_pixel;
+            count -= take;
+        }
+    }
+
+    void inflate_write(const uint8_t* data, size_t len) {
+        if (!hub75) return;
+
+        while (len > 0) {
+            size_t written = inflate_ring.write(data, len);
+            data += written;
+            len -= written;
+            if (len > 0) tight_loop_contents();  // Ring full, core 1 is inflating
+        }
+    }
+
+    void inflate_abort() {
+        inflate_aborted.store(true, std::memory_order_release);
+    }
+
+    bool delta_allowed() {
+        return !keyframe_needed.load(std::memory_order_relaxed);
+    }
+
+    void keyframe_landed() {
+        keyframe_needed.store(false, std::memory_order_relaxed);
+    }
+
+    // Rows of `buffer` holding any overlay pixel that isn't transparent, as row_mask() marks them
+    static uint64_t overlay_coverage() {
+        uint64_t rows = 0;
+        for (int y = 0; y < view_height; y++) {
+            const uint32_t* row = overlay + y * view_width;
+            if (std::any_of(row, row + view_width, [](uint32_t pixel) { return pixel >> 24; })) {
+                rows |= row_mask(y, 1);
+            }
+        }
+        return rows;
+    }
+
+    static void fill_overlay(int x, int y, int w, int h, uint32_t colour) {
+        int left = std::max(x, 0);
+        int right = std::min(x + w, view_width);
+        for (int row = std::max(y, 0); row < std::min(y + h, view_height) && left < right; row++) {
+            std::fill(overlay + row * view_width + left, overlay + row * view_width + right, colour);
+        }
+    }
+
+    // Shows overlay rows that changed (with the committed frame if one waits for its flip), or leaves them
+    // for core 1 to pick up with the frame streaming in
+    static void overlay_changed(uint64_t rows, bool present) {
+        if (present) {
+            redraw(rows);
+        } else {
+            overlay_pending.store(true, std::memory_order_release);
+        }
+    }
+
+    void overlay_text(int x, int y, const std::string& text, uint32_t colour, uint32_t background, int scale,
+                      bool present) {
+        if (!hub75) return;
+
+        scale = std::clamp(scale, 1, OVERLAY_MAX_SCALE);
+        GlyphCache& font = overlay_fonts[scale - 1];
+        if (!font.ready() && !font.build(FONT, FONT_HEIGHT, scale)) return;
+
+        uint64_t rows = row_mask(y, font.height());
+        {
+            OverlayLock lock;
+            if (background >> 24) {
+                fill_overlay(x, y, font.measure(text), font.height(), background);
+            }
+            font.draw(overlay, view_width, view_height, x, y, text, colour);
+
+            // ✅ Text in a transparent colour erases, only a full scan knows what is still covered then
+            overlay_rows = colour >> 24 ? overlay_rows | rows : overlay_coverage();
+        }
+        overlay_changed(rows, present);
+    }
+
+    void overlay_clear(int x, int y, int w, int h, bool present) {
+        if (!hub75) return;
+
+        {
+            OverlayLock lock;
+            fill_overlay(x, y, w, h, 0);
+            overlay_rows = overlay_coverage();
+        }
+        overlay_changed(row_mask(y, h), present);
     }
 
     void info(std::string text) {
+        acquire();
         clear();
         graphics.set_font(FONT);
+        console_shown.store(false, std::memory_order_relaxed);
 
         int line_number = 0;
         size_t start = 0;
         size_t end = 0;
         while ((end = text.find('\n', start)) != std::string::npos) {
-            graphics.text(text.substr(start, end - start), Point(0, FONT_HEIGHT * line_number), WIDTH, 1, 0, 1, false);
+            graphics.text(text.substr(start, end - start), Point(0, FONT_HEIGHT * line_number), view_width, 1, 0, 1, false);
             start = end + 1;
             line_number++;
         }
@@ -128,40 +961,101 @@ namespace matrix {
 
         // Print last line (or if no newline was found)
         if (start < text.size()) {
-            graphics.text(text.substr(start), Point(0, FONT_HEIGHT * line_number), WIDTH, 1, 0, 1, false);
+            graphics.text(text.substr(start), Point(0, FONT_HEIGHT * line_number), view_width, 1, 0, 1, false);
         }
 
         update();
     }
 
+    // Oldest line on screen
+    static uint32_t console_top(uint32_t rows) {
+        return console_total > rows ? console_total - rows : 0;
+    }
+
+    static void start_console_line() {
+        console_lines[console_total % CONSOLE_LINES].clear();
+        console_total++;
+        console_width = 0;
+    }
+
+    // Clears the band of `line` and draws it, `top` being the line at the top of the screen
+    static void draw_console_line(uint32_t line, uint32_t top) {
+        const size_t row_bytes = view_width * 4;
+        int y = (line - top) * FONT_HEIGHT;
+        std::memset(buffer + y * row_bytes, 0, FONT_HEIGHT * row_bytes);
+        console_font.draw(reinterpret_cast<uint32_t*>(buffer), view_width, view_height, 0, y,
+                          console_lines[line % CONSOLE_LINES], 0xffffff);
+    }
+
     void clearscreen() {
-        text_buffer.clear();
-        redraw();
+        acquire();
+        console_total = 0;
+        console_width = 0;
+        console_newline = true;
+        clear();
+        console_shown.store(true, std::memory_order_relaxed);
+        update();
     }
 
     void print(std::string text, bool append) {
-        std::string temp_line = "";
+        acquire();
+        if (!console_font.ready()) console_font.build(FONT, FONT_HEIGHT);
 
-        graphics.set_pen(255, 255, 255);
-        graphics.set_font(FONT);
+        const uint32_t rows = view_height / FONT_HEIGHT;
+        const uint32_t top_before = console_top(rows);
+        uint32_t first_changed = UINT32_MAX;
 
         if (!append) text += "\n"; // Ensure new prints start on a new line
 
         for (char c : text) {
-            std::string test_line = temp_line + c;  // ✅ Simulate adding the character
+            if (c == '\n') {
+                // ✅ A line only scrolls onto the screen once something is printed on it, or it is left empty
+                if (console_newline) {
+                    start_console_line();
+                    first_changed = std::min(first_changed, console_total - 1);
+                }
+                console_newline = true;
+                continue;
+            }
+
+            int width = console_font.advance(c);
+            if (console_newline || (console_width > 0 && console_width + width >= view_width)) {
+                start_console_line();  // ✅ Wrap when the character would overflow
+                console_newline = false;
+            }
+            first_changed = std::min(first_changed, console_total - 1);
+            console_lines[(console_total - 1) % CONSOLE_LINES] += c;
+            console_width += width;
+        }
 
-            int current_width = graphics.measure_text(test_line, 1, 1, false);
+        const uint32_t top = console_top(rows);
+        const uint32_t scrolled = top - top_before;
 
-            if (current_width >= WIDTH) {
-                text_buffer.push_back('\n'); // ✅ Insert newline when overflowing
-                temp_line.clear();
+        if (!console_shown.load(std::memory_order_relaxed) || scrolled >= rows) {
+            // ✅ A frame was drawn over the console, or all of it scrolled away
+            clear();
+            for (uint32_t line = top; line < console_total; line++) {
+                draw_console_line(line, top);
             }
+            console_shown.store(true, std::memory_order_relaxed);
+            update();
+            return;
+        }
+
+        if (first_changed == UINT32_MAX) return;
 
-            temp_line += c;  // ✅ Now actually add the character
-            text_buffer.push_back(c);
+        if (scrolled > 0) {
+            // ✅ Shift the lines that stay on screen up instead of drawing them again
+            const size_t row_bytes = view_width * 4;
+            const size_t shift = scrolled * FONT_HEIGHT * row_bytes;
+            std::memmove(buffer, buffer + shift, rows * FONT_HEIGHT * row_bytes - shift);
+        }
 
-            scroll();
+        // ✅ Only the lines printed on are drawn, the bands scrolled free included
+        uint32_t first = std::max(first_changed, top);
+        for (uint32_t line = first; line < console_total; line++) {
+            draw_console_line(line, top);
         }
-        redraw();
+        update(scrolled > 0 ? ALL_ROWS : row_mask((first - top) * FONT_HEIGHT, (console_total - first) * FONT_HEIGHT));
     }
 }
@@ -6,12 +6,120 @@
 
 
 namespace matrix {
+    // The panel. Frames use width() x height(), which swaps these when `rotation` is 90 or 270
     const int WIDTH = 256;
     const int HEIGHT = 64;
     const size_t BUFFER_SIZE = WIDTH * HEIGHT * 4;
 
+    // One bit per row of `buffer`, used to only re-convert what changed. Rotated sideways a row of
+    // `buffer` crosses every panel row, any change then marks them all.
+    static_assert(HEIGHT <= 64, "Row masks are 64 bits wide");
+    const uint64_t ALL_ROWS = HEIGHT == 64 ? ~0ull : (1ull << HEIGHT) - 1;
+
+    int width();    // Row length of `buffer`
+    int height();   // Rows in `buffer`
+    uint64_t row_mask(int first, int count);
+
+    // Pixel layouts accepted on the wire, all little endian
+    enum class PixelFormat : uint8_t {
+        RGBX8888,   // 4 bytes, B G R x: the native layout of `buffer`
+        RGB888,     // 3 bytes, B G R: RGBX8888 without the padding byte
+        RGB565,     // 2 bytes, rrrrrggg gggbbbbb as a 16 bit value
+        INDEX8,     // 1 byte, index into the palette
+        INDEX4      // 4 bits, index into the first 16 palette entries, high nibble first
+    };
+
+    const size_t PALETTE_SIZE = 256;
+
+    // One bit per pixel of `buffer`, for a PixelWriter whose input may cover some pixels twice
+    const size_t LANDED_MAP_WORDS = WIDTH * HEIGHT / 32;
+
+    // Streams wire pixels into a region of `buffer` as they arrive, split any way (even mid-pixel),
+    // unpacking them to the native layout. The region may hang off any edge of the panel (a negative
+    // origin places a larger canvas with the panel somewhere inside it); pixels outside are dropped.
+    // Given a `landed_map` (LANDED_MAP_WORDS, cleared by begin), a pixel written twice counts once.
+    class PixelWriter {
+    public:
+        void begin(int x, int y, uint16_t w, uint16_t h, PixelFormat format = PixelFormat::RGBX8888,
+                   uint32_t* landed_map = nullptr);
+        void write(const uint8_t* data, size_t len);
+        void seek(size_t offset);  // Continue at a wire byte offset, which must start a whole pixel
+        // Where the next wire bytes land when they can be copied there as they are (RGBX8888 rows as wide as
+        // the view, no pixel half written), for at most `len` bytes; nullptr otherwise. Transports that read
+        // into it report how much they did with wrote_in_place().
+        uint8_t* window(size_t& len);
+        void wrote_in_place(size_t len);
+        uint64_t rows() const { return dirty_rows; }
+        size_t pixels_landed() const { return landed; }  // Pixels written to the panel since begin()
+
+    private:
+        void write_pixels(const uint8_t* data, size_t count);
+        size_t mark_landed(size_t first, size_t count);
+
+        int x = 0, y = 0;
+        uint16_t w = 0, h = 0;
+        PixelFormat format = PixelFormat::RGBX8888;
+        size_t bytes_per_pixel = 4;
+        size_t pixel = 0;               // Index of the next pixel within the region
+        uint8_t partial[4];             // A pixel split across two writes
+        size_t partial_len = 0;
+        size_t landed = 0;
+        uint32_t* landed_map = nullptr;
+        uint64_t dirty_rows = 0;
+    };
+
+    // Conversion, decompression and scan-out run on core 1. These calls queue work in order
+    // and return immediately; call acquire() before writing to `buffer` from core 0.
     void init(KVStore& kvStore);
-    void update();
+    void update(uint64_t rows = ALL_ROWS);  // commit() followed by flip()
+    void commit(uint64_t rows = ALL_ROWS);  // Convert changed rows of buffer into the hidden back buffer
+    void flip();        // Present the back buffer at the next vblank
+    void flip_at(uint64_t time_us);  // Present it at the first vblank after a time_us_64() instant
+    // Convert rows again after something other than `buffer` changed (tables, overlay) and present them,
+    // unless a committed frame is waiting for its flip: it is converted again and shown with that instead
+    void redraw(uint64_t rows = ALL_ROWS);
+    void acquire();     // Wait until core 1 has finished with `buffer`
+
+    // How closely timed presents hit their deadline; the wait for the vblank is included
+    struct PresentStats {
+        uint32_t presents = 0;
+        uint32_t late_us = 0;       // Of the most recent one
+        uint32_t max_late_us = 0;
+    };
+    PresentStats present_stats();
+
+    // Streaming zlib decode into `buffer`: announce the compressed size (after acquire()), then feed
+    // exactly that many bytes in whatever pieces they arrive. Abort if the sender goes away early.
+    // A delta frame inflates to the XOR of the new frame with the current contents of `buffer`,
+    // other frames may use any full frame wire format.
+    void inflate_begin(size_t compressed_size, bool present, bool delta = false,
+                       PixelFormat format = PixelFormat::RGBX8888);
+    void inflate_write(const uint8_t* data, size_t len);
+    void inflate_abort();
+    // A frame that fails to inflate (corrupt, or cut short) leaves part of itself in `buffer`, which
+    // is then no base to XOR a delta onto. Deltas are refused until a keyframe (a zipped or raw full
+    // frame) lands; ask after acquire(). Raw frames are written by the server, which reports them.
+    bool delta_allowed();
+    void keyframe_landed();
+
+    // Replaces the first len / 4 palette entries with RGBX8888 colours
+    void set_palette(const uint8_t* data, size_t len);
+    void set_brightness(int brightness);  // 0-255, scales the gamma tables and redraws
+
+    // Per-channel curves replacing gamma correction, to match the white points of panels: 256 red,
+    // then green, then blue little endian 16 bit levels (0-1023, the Hub75 range) for each 8 bit
+    // input. Brightness still scales them. Kept in flash; an empty table restores gamma correction.
+    const size_t CALIBRATION_SIZE = 3 * 256 * 2;
+    bool set_calibration(KVStore& kvStore, const uint8_t* data, size_t len);
+    // A plane drawn over `buffer` while it is converted, so text stays put while frames stream in under
+    // it. Colours are 0xAARRGGBB: 0 alpha leaves the frame showing, 255 covers it. Changes are presented
+    // as redraw() does, or with `present` false (another connection's frame is streaming into `buffer`)
+    // picked up with the next frame. Neither waits for the frames queued on core 1. Text uses the console
+    // font scaled by 1 to OVERLAY_MAX_SCALE, a background with any alpha fills its box first.
+    const int OVERLAY_MAX_SCALE = 4;
+    void overlay_text(int x, int y, const std::string& text, uint32_t colour, uint32_t background, int scale,
+                      bool present = true);
+    void overlay_clear(int x, int y, int w, int h, bool present = true);
     void clearscreen();
     void info(std::string text);
     void print(std::string text, bool append = false);
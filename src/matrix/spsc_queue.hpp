@@ -0,0 +1,88 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Lock-free single producer / single consumer ring buffer, used to hand work from core 0 to core 1.
+// N must be a power of two; head and tail are free running and only wrap when indexing.
+template<typename T, size_t N>
+class SpscQueue {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            return false;  // Full
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) {
+            return false;  // Empty
+        }
+        item = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T items[N];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
+
+// Byte-oriented variant for streaming payloads. The consumer reads in place through peek()/consume(),
+// so data is only copied once, on the way in.
+template<size_t N>
+class SpscByteRing {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "SpscByteRing size must be a power of two");
+
+public:
+    // Returns the number of bytes accepted, which is less than `len` when the ring is full
+    size_t write(const uint8_t* data, size_t len) {
+        size_t h = head.load(std::memory_order_relaxed);
+        len = std::min(len, N - (h - tail.load(std::memory_order_acquire)));
+
+        size_t index = h & (N - 1);
+        size_t first = std::min(len, N - index);
+        std::memcpy(bytes + index, data, first);
+        std::memcpy(bytes, data + first, len - first);
+
+        head.store(h + len, std::memory_order_release);
+        return len;
+    }
+
+    // Points `data` at the oldest unread byte and returns how many can be read contiguously
+    size_t peek(const uint8_t*& data) const {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t available = head.load(std::memory_order_acquire) - t;
+        size_t index = t & (N - 1);
+        data = bytes + index;
+        return std::min(available, N - index);
+    }
+
+    void consume(size_t len) {
+        tail.store(tail.load(std::memory_order_relaxed) + len, std::memory_order_release);
+    }
+
+    void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    uint8_t bytes[N];
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+};
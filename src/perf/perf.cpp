@@ -0,0 +1,117 @@
+#include "perf.hpp"
+#include <algorithm>
+#include <atomic>
+
+#if PICO_RP2350
+#include "hardware/clocks.h"
+#endif
+
+#define BINARY_MAGIC "mvst"
+#define BINARY_VERSION 1
+
+namespace perf {
+    static std::atomic<uint32_t> counters[static_cast<size_t>(Counter::COUNT)];
+
+    // ✅ Written by one core only, so no locking; a reader on the other core may see a sum one update
+    // behind its count, which is close enough for statistics
+    static volatile TimerStats timers[static_cast<size_t>(Timer::COUNT)];
+
+    static const char* const COUNTER_NAMES[] = {
+        "messages", "bad_headers", "bytes", "frames", "frames_dropped", "inflate_failures",
+        "mem_err", "pbuf_pool_err", "memp_err", "tcp_drop"
+    };
+    static_assert(sizeof(COUNTER_NAMES) / sizeof(COUNTER_NAMES[0]) == static_cast<size_t>(Counter::COUNT),
+                  "A name for every counter");
+
+    static const char* const TIMER_NAMES[] = {"header", "reassembly", "inflate", "convert", "acquire"};
+    static_assert(sizeof(TIMER_NAMES) / sizeof(TIMER_NAMES[0]) == static_cast<size_t>(Timer::COUNT),
+                  "A name for every timer");
+
+    void start_core() {
+#if PICO_RP2350
+        // ✅ The counter sits in each core's own debug block, core 1 has to start its own
+        m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+        m33_hw->dwt_cyccnt = 0;
+        m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+    }
+
+    uint32_t clock_hz() {
+#if PICO_RP2350
+        return clock_get_hz(clk_sys);
+#else
+        return 1000000;
+#endif
+    }
+
+    void add(Counter counter, uint32_t n) {
+        counters[static_cast<size_t>(counter)].fetch_add(n, std::memory_order_relaxed);
+    }
+
+    void set(Counter counter, uint32_t value) {
+        counters[static_cast<size_t>(counter)].store(value, std::memory_order_relaxed);
+    }
+
+    void record(Timer timer, uint32_t cycles) {
+        volatile TimerStats& stats = timers[static_cast<size_t>(timer)];
+        stats.count = stats.count + 1;
+        stats.total_cycles = stats.total_cycles + cycles;
+        if (cycles > stats.max_cycles) {
+            stats.max_cycles = cycles;
+        }
+    }
+
+    uint64_t total_cycles(Timer timer) {
+        return timers[static_cast<size_t>(timer)].total_cycles;
+    }
+
+    static TimerStats read(size_t timer) {
+        TimerStats stats;
+        stats.count = timers[timer].count;
+        stats.max_cycles = timers[timer].max_cycles;
+        stats.total_cycles = timers[timer].total_cycles;
+        return stats;
+    }
+
+    std::string json() {
+        std::string out = "{\"clock_hz\":" + std::to_string(clock_hz());
+        for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+            out += ",\"" + std::string(COUNTER_NAMES[i]) + "\":" +
+                   std::to_string(counters[i].load(std::memory_order_relaxed));
+        }
+        for (size_t i = 0; i < static_cast<size_t>(Timer::COUNT); i++) {
+            TimerStats stats = read(i);
+            out += ",\"" + std::string(TIMER_NAMES[i]) + "\":{\"count\":" + std::to_string(stats.count) +
+                   ",\"cycles\":" + std::to_string(stats.total_cycles) +
+                   ",\"max\":" + std::to_string(stats.max_cycles) + "}";
+        }
+        return out + "}";
+    }
+
+    static uint8_t* put_be(uint8_t* out, uint64_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) {
+            out[i] = value & 0xff;
+            value >>= 8;
+        }
+        return out + bytes;
+    }
+
+    void binary(uint8_t* out) {
+        std::copy(BINARY_MAGIC, BINARY_MAGIC + 4, out);
+        out[4] = BINARY_VERSION;
+        out[5] = static_cast<uint8_t>(Counter::COUNT);
+        out[6] = static_cast<uint8_t>(Timer::COUNT);
+        out[7] = 0;
+        out = put_be(out + 8, clock_hz(), 4);
+
+        for (size_t i = 0; i < static_cast<size_t>(Counter::COUNT); i++) {
+            out = put_be(out, counters[i].load(std::memory_order_relaxed), 4);
+        }
+        for (size_t i = 0; i < static_cast<size_t>(Timer::COUNT); i++) {
+            TimerStats stats = read(i);
+            out = put_be(out, stats.count, 4);
+            out = put_be(out, stats.max_cycles, 4);
+            out = put_be(out, stats.total_cycles, 8);
+        }
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef PERF_HPP
+#define PERF_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pico/stdlib.h"
+
+#if PICO_RP2350
+#include "hardware/structs/m33.h"
+#endif
+
+// Counters and cycle timers for what the firmware does under load, cheap enough to leave in every build.
+// Each timer is only ever recorded from one core; counters may be bumped from either.
+namespace perf {
+    enum class Counter : uint8_t {
+        MESSAGES,           // Headers accepted, any transport
+        BAD_HEADERS,        // Wrong prefix or unknown command
+        BYTES,              // Received on TCP and USB sessions and in UDP frame fragments
+        FRAMES,             // Frames (and regions) received in full
+        FRAMES_DROPPED,     // Drained while the framebuffer was busy, cut short, or superseded (UDP)
+        INFLATE_FAILURES,   // Corrupt or truncated zlib streams
+        MEM_ERR,            // lwIP heap allocations that failed (PBUF_RAM and friends)
+        PBUF_POOL_ERR,      // Receive pbufs the pool had none left for
+        MEMP_ERR,           // Failed allocations from any lwIP pool, the pbuf pool included
+        TCP_DROP,           // Segments lwIP dropped
+        COUNT
+    };
+
+    enum class Timer : uint8_t {
+        HEADER,             // Parsing and dispatching a message header, waits for core 1 left out, core 0
+        REASSEMBLY,         // Placing payload bytes, per received piece, core 0
+        INFLATE,            // Inflating a compressed frame, waits for its bytes left out, core 1
+        CONVERT,            // Converting rows into a Hub75 buffer, core 1
+        ACQUIRE,            // Waiting in matrix::acquire() for core 1 to finish its jobs, core 0
+        COUNT
+    };
+
+    struct TimerStats {
+        uint32_t count = 0;
+        uint32_t max_cycles = 0;
+        uint64_t total_cycles = 0;
+    };
+
+    // Size of binary(): "mvst", version, counter and timer counts, reserved, clock_hz, the counters (4 bytes
+    // each) and the timers (count 4, max 4, total 8), all big endian
+    const size_t BINARY_SIZE = 12 + 4 * static_cast<size_t>(Counter::COUNT) + 16 * static_cast<size_t>(Timer::COUNT);
+
+    void start_core();  // Starts the calling core's cycle counter, once on each core
+
+    // DWT cycle counter of the calling core; microseconds where there is none
+    inline uint32_t cycles() {
+#if PICO_RP2350
+        return m33_hw->dwt_cyccnt;
+#else
+        return time_us_32();
+#endif
+    }
+
+    uint32_t clock_hz();  // Rate cycles() counts at
+
+    void add(Counter counter, uint32_t n = 1);
+    void set(Counter counter, uint32_t value);  // For counters sampled from elsewhere, like lwIP's
+    void record(Timer timer, uint32_t cycles);
+    uint64_t total_cycles(Timer timer);  // Sum recorded so far, read on the core that records it
+
+    // Records the cycles from construction to destruction, less those recorded on `excluded` in between
+    class Scope {
+    public:
+        explicit Scope(Timer timer, Timer excluded = Timer::COUNT)
+            : timer(timer), excluded(excluded), start(cycles()), excluded_start(excluded_cycles()) {}
+        ~Scope() { record(timer, cycles() - start - static_cast<uint32_t>(excluded_cycles() - excluded_start)); }
+
+    private:
+        uint64_t excluded_cycles() const { return excluded == Timer::COUNT ? 0 : total_cycles(excluded); }
+
+        Timer timer;
+        Timer excluded;
+        uint32_t start;
+        uint64_t excluded_start;
+    };
+
+    std::string json();
+    void binary(uint8_t* out);  // BINARY_SIZE bytes
+}
+
+#endif // PERF_HPP
@@ -1,8 +1,9 @@
 #ifndef COMMAND_CONFIG_HPP
 #define COMMAND_CONFIG_HPP
 
+#include <cstdint>
 #include <string>
-#include <unordered_set>
+#include "matrix.hpp"
 
 // Define all valid commands here
 namespace CommandConfig {
@@ -20,17 +21,163 @@ namespace CommandConfig {
     constexpr char DELETE[] = "kdel";
     constexpr char SHOWDATA[] = "sdat";
     constexpr char DATA[] = "data";
+    constexpr char SHOWDATA888[] = "s888";
+    constexpr char DATA888[] = "d888";
+    constexpr char SHOWDATA565[] = "s565";
+    constexpr char DATA565[] = "d565";
+    constexpr char PALETTE[] = "pltt";
+    constexpr char CALIBRATION[] = "clut";
+    constexpr char SHOWINDEX8[] = "sid8";
+    constexpr char INDEX8[] = "idx8";
+    constexpr char SHOWINDEX4[] = "sid4";
+    constexpr char INDEX4[] = "idx4";
     constexpr char SHOWZIPPED[] = "szip";
     constexpr char ZIPPED[] = "zipd";
+    constexpr char SHOWDELTAZIPPED[] = "sxzp";
+    constexpr char DELTAZIPPED[] = "xzip";
+    constexpr char SHOWZIPPEDINDEX8[] = "szx8";
+    constexpr char ZIPPEDINDEX8[] = "zix8";
+    constexpr char SHOWZIPPEDINDEX4[] = "szx4";
+    constexpr char ZIPPEDINDEX4[] = "zix4";
+    constexpr char SHOWRECT[] = "srct";
+    constexpr char RECT[] = "rect";
     constexpr char USB_DISCOVERY[] = "UDSC";
     constexpr char FACTORY_RESET[] = "FACR";
+    constexpr char STATS[] = "stat";            // Answered with perf counters as JSON
+    constexpr char STATS_BINARY[] = "stbn";     // The same as perf::binary() lays them out
+    constexpr char TRACE[] = "trce";            // Answered with the trace ring, see trace::dump()
+    constexpr char OVERLAY_TEXT[] = "ovtx";     // Text on the overlay over the frames, see matrix::overlay_text
+    constexpr char OVERLAY_CLEAR[] = "ovcl";    // Clears a region header's worth of the overlay, or all of it
 
 
-    // Optional: Store as a set for validation or lookup
-    const std::unordered_set<std::string> SUPPORTED_COMMANDS = {
-        RESET, BOOTLOADER, CLEARSCREEN, SYNC, IPV4, IPV6, WRITE, GET, SET,
-        DELETE, DATA, SHOWDATA, SHOWZIPPED, ZIPPED
+    // The 4 command bytes read as a big endian word; headers are dispatched on this rather than on strings
+    constexpr uint32_t fourcc(const char* name) {
+        return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24 |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16 |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8 |
+               static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+    }
+
+    inline std::string name(uint32_t code) {
+        return {static_cast<char>(code >> 24), static_cast<char>(code >> 16),
+                static_cast<char>(code >> 8), static_cast<char>(code)};
+    }
+
+    // What each command does with its payload, shared by every transport
+    namespace Flag {
+        constexpr uint16_t PAYLOAD = 1 << 0;        // Takes a payload
+        constexpr uint16_t RAW_FRAME = 1 << 1;      // A full frame of pixels, written in place as it arrives
+        constexpr uint16_t REGION = 1 << 2;         // A region header then RGBX8888 pixels, written in place
+        constexpr uint16_t ZIPPED = 1 << 3;         // A zlib stream, inflated on core 1 as it arrives
+        constexpr uint16_t DELTA = 1 << 4;          // Inflates to the XOR with the frame in the framebuffer
+        constexpr uint16_t SHOWS = 1 << 5;          // Presented once complete, otherwise committed for a sync
+        constexpr uint16_t WRITES_CANVAS = 1 << 6;  // Needs the framebuffer to itself while it streams in
+        constexpr uint16_t KEY_VALUE = 1 << 7;      // A "key:value" payload
+
+        constexpr uint16_t FRAME = PAYLOAD | RAW_FRAME | WRITES_CANVAS;
+        constexpr uint16_t ZIPPED_FRAME = PAYLOAD | ZIPPED | WRITES_CANVAS;
+    }
+
+    struct Command {
+        uint32_t code;
+        uint16_t flags;
+        matrix::PixelFormat format;  // Of frame payloads
     };
+
+    // Commands accepted in a message header (dscv arrives over multicast and UDSC over USB, outside it)
+    constexpr Command COMMANDS[] = {
+        {fourcc(RESET), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(BOOTLOADER), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(FACTORY_RESET), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(CLEARSCREEN), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(SYNC), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(IPV4), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(IPV6), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(WRITE), 0, matrix::PixelFormat::RGBX8888},
+#if MULTIVERSE_STATS
+        {fourcc(STATS), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(STATS_BINARY), 0, matrix::PixelFormat::RGBX8888},
+#endif
+        {fourcc(TRACE), 0, matrix::PixelFormat::RGBX8888},
+        {fourcc(PRINT), Flag::PAYLOAD, matrix::PixelFormat::RGBX8888},
+        {fourcc(OVERLAY_TEXT), Flag::PAYLOAD, matrix::PixelFormat::RGBX8888},
+        {fourcc(OVERLAY_CLEAR), Flag::PAYLOAD, matrix::PixelFormat::RGBX8888},
+        {fourcc(GET), Flag::PAYLOAD | Flag::KEY_VALUE, matrix::PixelFormat::RGBX8888},
+        {fourcc(SET), Flag::PAYLOAD | Flag::KEY_VALUE, matrix::PixelFormat::RGBX8888},
+        {fourcc(DELETE), Flag::PAYLOAD | Flag::KEY_VALUE, matrix::PixelFormat::RGBX8888},
+        {fourcc(PALETTE), Flag::PAYLOAD | Flag::WRITES_CANVAS, matrix::PixelFormat::RGBX8888},
+        {fourcc(CALIBRATION), Flag::PAYLOAD | Flag::WRITES_CANVAS, matrix::PixelFormat::RGBX8888},
+        {fourcc(DATA), Flag::FRAME, matrix::PixelFormat::RGBX8888},
+        {fourcc(SHOWDATA), Flag::FRAME | Flag::SHOWS, matrix::PixelFormat::RGBX8888},
+        {fourcc(DATA888), Flag::FRAME, matrix::PixelFormat::RGB888},
+        {fourcc(SHOWDATA888), Flag::FRAME | Flag::SHOWS, matrix::PixelFormat::RGB888},
+        {fourcc(DATA565), Flag::FRAME, matrix::PixelFormat::RGB565},
+        {fourcc(SHOWDATA565), Flag::FRAME | Flag::SHOWS, matrix::PixelFormat::RGB565},
+        {fourcc(INDEX8), Flag::FRAME, matrix::PixelFormat::INDEX8},
+        {fourcc(SHOWINDEX8), Flag::FRAME | Flag::SHOWS, matrix::PixelFormat::INDEX8},
+        {fourcc(INDEX4), Flag::FRAME, matrix::PixelFormat::INDEX4},
+        {fourcc(SHOWINDEX4), Flag::FRAME | Flag::SHOWS, matrix::PixelFormat::INDEX4},
+        {fourcc(ZIPPED), Flag::ZIPPED_FRAME, matrix::PixelFormat::RGBX8888},
+        {fourcc(SHOWZIPPED), Flag::ZIPPED_FRAME | Flag::SHOWS, matrix::PixelFormat::RGBX8888},
+        {fourcc(DELTAZIPPED), Flag::ZIPPED_FRAME | Flag::DELTA, matrix::PixelFormat::RGBX8888},
+        {fourcc(SHOWDELTAZIPPED), Flag::ZIPPED_FRAME | Flag::DELTA | Flag::SHOWS, matrix::PixelFormat::RGBX8888},
+        {fourcc(ZIPPEDINDEX8), Flag::ZIPPED_FRAME, matrix::PixelFormat::INDEX8},
+        {fourcc(SHOWZIPPEDINDEX8), Flag::ZIPPED_FRAME | Flag::SHOWS, matrix::PixelFormat::INDEX8},
+        {fourcc(ZIPPEDINDEX4), Flag::ZIPPED_FRAME, matrix::PixelFormat::INDEX4},
+        {fourcc(SHOWZIPPEDINDEX4), Flag::ZIPPED_FRAME | Flag::SHOWS, matrix::PixelFormat::INDEX4},
+        {fourcc(RECT), Flag::PAYLOAD | Flag::REGION | Flag::WRITES_CANVAS, matrix::PixelFormat::RGBX8888},
+        {fourcc(SHOWRECT), Flag::PAYLOAD | Flag::REGION | Flag::WRITES_CANVAS | Flag::SHOWS, matrix::PixelFormat::RGBX8888},
+    };
+    constexpr size_t COMMAND_COUNT = sizeof(COMMANDS) / sizeof(COMMANDS[0]);
+
+    // Perfect hash: a seed, searched for at compile time, that sends every command to its own slot
+    constexpr int SLOT_BITS = 7;
+    constexpr size_t SLOT_COUNT = size_t(1) << SLOT_BITS;
+    static_assert(COMMAND_COUNT < SLOT_COUNT && COMMAND_COUNT < 128, "Too many commands for the slot table");
+
+    constexpr size_t slot(uint32_t code, uint32_t seed) {
+        uint32_t h = code ^ seed;   // ✅ Command bytes are all ASCII letters, mix them before taking the top bits
+        h ^= h >> 16;
+        h *= 0x45d9f3b;
+        h ^= h >> 16;
+        return h >> (32 - SLOT_BITS);
+    }
+
+    constexpr uint32_t find_seed() {
+        for (uint32_t seed = 1; seed < 100000; seed++) {
+            bool used[SLOT_COUNT] = {};
+            bool clash = false;
+            for (const Command& command : COMMANDS) {
+                size_t s = slot(command.code, seed);
+                clash = clash || used[s];
+                used[s] = true;
+            }
+            if (!clash) return seed;
+        }
+        return 0;
+    }
+
+    constexpr uint32_t SLOT_SEED = find_seed();
+    static_assert(SLOT_SEED != 0, "No perfect hash for the command set");
+
+    struct SlotTable {
+        int8_t index[SLOT_COUNT];
+    };
+
+    constexpr SlotTable build_slots() {
+        SlotTable table{};
+        for (size_t i = 0; i < SLOT_COUNT; i++) table.index[i] = -1;
+        for (size_t i = 0; i < COMMAND_COUNT; i++) table.index[slot(COMMANDS[i].code, SLOT_SEED)] = i;
+        return table;
+    }
+
+    constexpr SlotTable SLOTS = build_slots();
+
+    // nullptr for anything not in COMMANDS
+    inline const Command* find(uint32_t code) {
+        int8_t i = SLOTS.index[slot(code, SLOT_SEED)];
+        return i >= 0 && COMMANDS[i].code == code ? &COMMANDS[i] : nullptr;
+    }
 }
 
 #endif // COMMAND_CONFIG_HPP
\ No newline at end of file
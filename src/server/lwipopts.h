@@ -55,9 +55,16 @@
 #define LWIP_NETIF_LINK_CALLBACK    1
 #define LWIP_NETIF_HOSTNAME         1
 #define LWIP_NETCONN                0
+#if MULTIVERSE_STATS
+#define LWIP_STATS                  1  // ✅ Heap, pool and TCP counters are reported by `stat`
+#define MEM_STATS                   1
+#define MEMP_STATS                  1
+#else
+#define LWIP_STATS                  0
 #define MEM_STATS                   0
-#define SYS_STATS                   0
 #define MEMP_STATS                  0
+#endif
+#define SYS_STATS                   0
 #define LINK_STATS                  0
 // #define ETH_PAD_SIZE                2
 #define LWIP_CHKSUM_ALGORITHM       3
@@ -83,7 +90,6 @@
 
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
-#define LWIP_STATS                  1
 #define LWIP_STATS_DISPLAY          1
 #endif
 
@@ -6,25 +6,233 @@
 
 #include "pico/cyw43_arch.h"
 #include "pico/bootrom.h"
+#if MULTIVERSE_STATS
+#include "lwip/stats.h"
+#endif
 #include "hardware/structs/rosc.h"
 #include "hardware/watchdog.h"
 #include "matrix.hpp"
 #include "config_storage.hpp"
+#include "perf.hpp"
+#include "trace.hpp"
 #include "zlib.h"
 
+using CommandConfig::fourcc;
+
+#define MAX_BUFFER_SIZE (65 * 1024)  // ✅ Prevents memory overflow
+#define REGION_HEADER_SIZE 8         // ✅ x, y, width, height as 16 bit big endian
+#define OVERLAY_TEXT_HEADER_SIZE 13  // ✅ x, y as signed 16 bit, colour and background as 0xAARRGGBB, scale
+#define MAX_TEXT_LENGTH 1024
+#define MAX_CONNECTIONS 4            // ✅ Connection pool size, `max_conn` can lower the limit
+#define MAX_SESSIONS 2               // ✅ Session pool size, one per USB interface
+#define SESSION_KEEPALIVE_IDLE_MS 5000
+#define SESSION_KEEPALIVE_INTERVAL_MS 1000
+#define SESSION_KEEPALIVE_COUNT 3
+
 struct RecvState {
+    ApiServer *server = nullptr;
+    tcp_pcb *pcb = nullptr;             // ✅ Connection using this slot, nullptr while free
     size_t expected_size = 0;
     size_t received_size = 0;
     bool receiving_data = false;
-    std::string command;
-    std::vector<uint8_t> header_buffer;
-    std::vector<uint8_t> recv_buffer; // ✅ Reassembly buffer
+    bool discarding = false;            // ✅ Payload is drained without being stored
+    const CommandConfig::Command *command = nullptr;  // ✅ Of the message being received
+    uint8_t header_buffer[HEADER_SIZE];
+    size_t header_received = 0;
+    uint8_t region_header[REGION_HEADER_SIZE];
+    size_t region_header_received = 0;
+    matrix::PixelWriter writer;         // ✅ Places raw pixels straight into the framebuffer
+    std::vector<uint8_t> recv_buffer;   // ✅ Reassembly buffer (kv, palette and text payloads only), kept between messages
+    ApiServer::SessionReply reply = nullptr;  // ✅ Sessions only: answers go back over their link
+    void *reply_context = nullptr;
+};
+
+// ✅ Fixed pools, connections and sessions never allocate their receive state
+static RecvState connections[MAX_CONNECTIONS];
+static RecvState sessions[MAX_SESSIONS];     // ✅ Free while `server` is nullptr
+#define LISTENER_SLOT 0xffffffff     // ✅ Traced in place of a connection slot for the listening pcb
+static const void *canvas_owner = nullptr;  // ✅ Connection (or UDP frame) being written to the framebuffer
+
+// ✅ UDP frames: fragments land directly in the framebuffer, a frame is only committed once complete
+#define UDP_FRAME_MAGIC "mvfr"
+#define UDP_FRAME_HEADER_SIZE 24
+#define UDP_CANVAS_HEADER_SIZE 4     // ✅ Canvas width and height, follows the header of canvas fragments
+#define UDP_TIMED_HEADER_SIZE 8      // ✅ Presentation time, follows the header (and canvas size) of timed fragments
+#define UDP_MAX_FRAGMENTS 1024
+#define UDP_FRAME_TIMEOUT_US 100000  // ✅ An incomplete frame gives up the framebuffer after this long
+#define UDP_FRAME_ID_WINDOW 1024     // ✅ Ids further behind than this mean the sender restarted
+#define UDP_FLAG_SHOW 0x01
+#define UDP_FLAG_CANVAS 0x02         // ✅ One canvas shared by many panels, each keeps its own region
+#define UDP_FLAG_TIMED 0x04          // ✅ Presented at a host clock time rather than on arrival
+
+struct UdpFrameState {
+    bool active = false;                // ✅ A frame is being reassembled
+    bool seen = false;                  // ✅ frame_id holds the id of a previous frame
+    uint32_t frame_id = 0;
+    uint32_t total_size = 0;
+    uint16_t fragment_count = 0;
+    uint32_t pixels_needed = 0;         // ✅ Pixels of the frame that land on this panel
+    uint8_t flags = 0;
+    matrix::PixelFormat format = matrix::PixelFormat::RGBX8888;
+    uint64_t present_at = 0;            // ✅ Host clock time, timed frames only
+    uint32_t received[UDP_MAX_FRAGMENTS / 32];
+    uint32_t landed[matrix::LANDED_MAP_WORDS];  // ✅ Pixels already written, overlapping fragments count once
+    uint32_t last_fragment_us = 0;
+    matrix::PixelWriter writer;
+
+    // ✅ Loss accounting, reported by discovery
+    uint32_t frames_completed = 0;
+    uint32_t frames_dropped = 0;        // ✅ Superseded or timed out before all fragments arrived
+    uint32_t fragments_late = 0;        // ✅ Belonged to a frame that was already completed or dropped
+    uint32_t fragments_rejected = 0;    // ✅ Malformed, or the framebuffer was busy
+};
+
+static UdpFrameState udp_frame;
+
+// ✅ Clock sync, NTP style: the host stamps a request (t1), we stamp its arrival (t2) and our reply (t3),
+// the host stamps the reply's arrival (t4) and sends all four back so we can work out the offset
+#define CLOCK_REQUEST_MAGIC "mvtq"
+#define CLOCK_REPLY_MAGIC "mvtr"
+#define CLOCK_RESULT_MAGIC "mvtf"
+#define PRESENT_MAGIC "mvps"
+#define CLOCK_REQUEST_SIZE 16        // ✅ Magic, sequence number, t1
+#define CLOCK_REPLY_SIZE 32          // ✅ Magic, sequence number, t1, t2, t3
+#define CLOCK_RESULT_SIZE 40         // ✅ Magic, sequence number, t1, t2, t3, t4
+#define PRESENT_SIZE 12              // ✅ Magic, host time to present at
+#define CLOCK_FILTER_SIZE 8
+#define CLOCK_MAX_DELAY_US 50000     // ✅ Round trips slower than this say little about the offset
+#define PRESENT_MAX_AHEAD_US 1000000 // ✅ A presentation time further ahead than this means the clocks disagree
+
+struct ClockSample {
+    int64_t offset_us;
+    uint32_t delay_us;
 };
 
-RecvState recv_state;
+struct ClockState {
+    ClockSample samples[CLOCK_FILTER_SIZE];  // ✅ The most recent exchanges
+    uint32_t sample_count = 0;
+    int64_t offset_us = 0;              // ✅ Local minus host time, taken from the recent exchange with the shortest round trip
+    uint32_t delay_us = 0;              // ✅ Round trip of that exchange
+    uint32_t jitter_us = 0;             // ✅ Mean distance of the recent offsets from offset_us
+    uint32_t samples_rejected = 0;
+    uint32_t presents_untimed = 0;      // ✅ Shown on arrival: clock not synced, or the time was already past or too far ahead
+};
+
+static ClockState clock_sync;
+
+static uint64_t get_be64(const uint8_t *data) {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+}
+
+static void put_be64(uint8_t *data, uint64_t value) {
+    for (int i = 7; i >= 0; i--) {
+        data[i] = value & 0xff;
+        value >>= 8;
+    }
+}
+
+// ✅ Flips at the local time matching a host clock time, or right away if that can't be trusted
+static void present_at_host_time(uint64_t host_us) {
+    int64_t now = static_cast<int64_t>(time_us_64());
+    int64_t local = static_cast<int64_t>(host_us) + clock_sync.offset_us;
+    if (clock_sync.sample_count == 0 || local <= now || local > now + PRESENT_MAX_AHEAD_US) {
+        clock_sync.presents_untimed++;
+        matrix::flip();
+        return;
+    }
+    matrix::flip_at(local);
+}
+
+// ✅ Frames (and the palette they use) are written to the shared framebuffer while they stream in, a calibration
+// redraws it: see CommandConfig::COMMANDS for what each command does
+static bool has(const RecvState &state, uint16_t flag) {
+    return state.command && (state.command->flags & flag);
+}
+
+// ✅ Text payloads are cut to MAX_TEXT_LENGTH and kept to printable ASCII
+static std::string printable(const uint8_t *data, size_t len) {
+    std::string text;
+    for (size_t i = 0; i < std::min(len, static_cast<size_t>(MAX_TEXT_LENGTH)); i++) {
+        if (data[i] >= 32 && data[i] <= 126) {
+            text += static_cast<char>(data[i]);
+        }
+    }
+    return text;
+}
+
+static bool carries_frame(const RecvState &state) {
+    return has(state, CommandConfig::Flag::RAW_FRAME | CommandConfig::Flag::REGION | CommandConfig::Flag::ZIPPED);
+}
+
+// ✅ Answers on the connection, or the session's link, a message came in on
+static void respond(const RecvState *state, const std::string &response) {
+    if (state->pcb) {
+        if (tcp_sndbuf(state->pcb) >= response.size()) {
+            tcp_write(state->pcb, response.data(), response.size(), TCP_WRITE_FLAG_COPY);
+            tcp_output(state->pcb);
+        }
+    } else if (state->reply) {
+        state->reply(state->reply_context, reinterpret_cast<const uint8_t *>(response.data()), response.size());
+    }
+}
+
+// ✅ Connections take the first slots in traces, sessions follow them
+static uint32_t slot_of(const RecvState *state) {
+    if (state >= connections && state < connections + MAX_CONNECTIONS) {
+        return state - connections;
+    }
+    if (state >= sessions && state < sessions + MAX_SESSIONS) {
+        return MAX_CONNECTIONS + (state - sessions);
+    }
+    return LISTENER_SLOT;
+}
+
+static void abandon_udp_frame() {
+    uint32_t fragments = 0;
+    for (uint32_t word: udp_frame.received) {
+        fragments += __builtin_popcount(word);
+    }
+    trace::log(trace::Event::UDP_DROPPED, udp_frame.frame_id, fragments);
+
+    udp_frame.active = false;
+    udp_frame.frames_dropped++;
+    perf::add(perf::Counter::FRAMES_DROPPED);
+    if (canvas_owner == &udp_frame) {
+        canvas_owner = nullptr;
+    }
+}
+
+// ✅ Whether another connection or a UDP frame holds the framebuffer. A UDP frame that stopped receiving
+// fragments is given up here, so a lost fragment never holds the canvas longer than UDP_FRAME_TIMEOUT_US.
+static bool canvas_busy(const RecvState *state) {
+    if (canvas_owner == &udp_frame && time_us_32() - udp_frame.last_fragment_us > UDP_FRAME_TIMEOUT_US) {
+        abandon_udp_frame();
+    }
+    return canvas_owner && canvas_owner != state;
+}
+
+// ✅ Status messages draw on the framebuffer too; while another connection's frame is in flight they are sent
+// back to the client instead, waiting for it could block on data that can only arrive once this callback returns.
+// Multicast ones have nobody to go back to and are dropped: DEBUG_PRINT draws too, so it would wait the same way.
+static void show_status(const RecvState *state, const std::string &text) {
+    if (canvas_busy(state)) {
+        if (state) {
+            respond(state, text + "\n");
+        }
+        return;
+    }
+    matrix::print(text);
+}
+
 
 ApiServer::ApiServer(KVStore &kvStore)
     : kvStore{kvStore}, server_pcb{nullptr} {
+    perf::start_core();  // ✅ Core 0 times the transports, core 1 starts its own counter
+
     ssid = kvStore.getParam("ssid");
     password = kvStore.getParam("pass");
     multicast_ip = kvStore.getParam("mcast_ip"); // Define a multicast IP
@@ -45,6 +253,11 @@ ApiServer::ApiServer(KVStore &kvStore)
     rotation = safe_stoi(kvStore.getParam("rotation"), 0, 0, 270);
     order = safe_stoi(kvStore.getParam("order"), 1, 0, 65535);
     brightness = safe_stoi(kvStore.getParam("brightness"), 127, 0, 255);
+    max_connections = safe_stoi(kvStore.getParam("max_conn"), MAX_CONNECTIONS, 1, MAX_CONNECTIONS);
+
+    // ✅ Region of a multicast canvas shown by this panel, by default panels sit side by side in `order`
+    canvas_x = safe_stoi(kvStore.getParam("canvas_x"), (order > 0 ? order - 1 : 0) * matrix::width(), 0, 65535);
+    canvas_y = safe_stoi(kvStore.getParam("canvas_y"), 0, 0, 65535);
 
     // Ensure rotation is only 0, 90, 180, or 270
     if (rotation != 0 && rotation != 90 && rotation != 180 && rotation != 270) {
@@ -169,7 +382,7 @@ void ApiServer::run() {
         return;
     }
 
-    server_pcb = tcp_listen_with_backlog(server_pcb, 1);
+    server_pcb = tcp_listen_with_backlog(server_pcb, TCP_DEFAULT_LISTEN_BACKLOG);
     if (!server_pcb) {
         DEBUG_PRINT("Failed to listen on TCP server");
         cyw43_arch_lwip_end();
@@ -184,277 +397,550 @@ void ApiServer::run() {
 
 err_t ApiServer::on_accept(void *arg, struct tcp_pcb *newpcb, err_t err) {
     if (err != ERR_OK || !newpcb) {
-        DEBUG_PRINT("TCP accept error");
+        trace::log(trace::Event::TCP_ERROR, LISTENER_SLOT, static_cast<uint32_t>(err));
         return ERR_VAL;
     }
 
     auto *server = static_cast<ApiServer *>(arg); // ✅ Retrieve ApiServer instance
-    DEBUG_PRINT("Client connected");
 
-    tcp_arg(newpcb, server); // ✅ Store server instance in the connection
+    // ✅ Take a free slot from the pool, within the configured limit
+    RecvState *state = nullptr;
+    int open_connections = 0;
+    for (RecvState &slot: connections) {
+        if (slot.pcb) {
+            open_connections++;
+        } else if (!state) {
+            state = &slot;
+        }
+    }
+
+    if (!state || open_connections >= server->max_connections) {
+        trace::log(trace::Event::REFUSED, open_connections);
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    trace::log(trace::Event::CONNECT, slot_of(state));
+    state->server = server;
+    state->pcb = newpcb;
+    reset_recv_state(*state);
+
+    tcp_arg(newpcb, state); // ✅ Each connection parses into its own slot
     tcp_recv(newpcb, ApiServer::on_receive);
     tcp_err(newpcb, ApiServer::on_error);
 
+    // ✅ Sessions idle between frames, so notice peers that vanish without closing
+    ip_set_option(newpcb, SOF_KEEPALIVE);
+    newpcb->keep_idle = SESSION_KEEPALIVE_IDLE_MS;
+    newpcb->keep_intvl = SESSION_KEEPALIVE_INTERVAL_MS;
+    newpcb->keep_cnt = SESSION_KEEPALIVE_COUNT;
+
     return ERR_OK;
 }
 
-#define MAX_BUFFER_SIZE (65 * 1024)  // ✅ Prevents memory overflow
-
 err_t ApiServer::on_receive(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err) {
-    auto *server = static_cast<ApiServer *>(arg);
+    auto *state = static_cast<RecvState *>(arg);
 
     if (!p) {
-        DEBUG_PRINT("Client disconnected");
-        server->reset_recv_state();
+        trace::log(trace::Event::DISCONNECT, slot_of(state));
+        reset_recv_state(*state);
+        state->pcb = nullptr;
+        tcp_arg(tpcb, nullptr);
         tcp_close(tpcb);
         return ERR_OK;
     }
 
-    size_t data_len = p->len;
-    uint8_t *payload = static_cast<uint8_t *>(p->payload);
+    // ✅ Walk the pbuf chain in place; payload bytes go straight to their destination
+    for (struct pbuf *q = p; q != nullptr; q = q->next) {
+        ingest(*state, static_cast<const uint8_t *>(q->payload), q->len);
+    }
+
+    tcp_recved(tpcb, p->tot_len); // ✅ Acknowledge full data received
     pbuf_free(p);
 
-    size_t offset = 0; // ✅ Use an explicit offset instead of modifying payload
+    return ERR_OK;
+}
+
+void ApiServer::ingest(RecvState &state, const uint8_t *data, size_t len) {
+    perf::add(perf::Counter::BYTES, len);
+
+    while (len > 0) {
+        if (!state.receiving_data) {
+            // ✅ Collect the fixed-size header, which may be split across segments
+            size_t take = std::min(HEADER_SIZE - state.header_received, len);
+            std::memcpy(state.header_buffer + state.header_received, data, take);
+            state.header_received += take;
+            data += take;
+            len -= take;
+
+            if (state.header_received < HEADER_SIZE) {
+                return;
+            }
+            state.header_received = 0;
+
+            bool accepted;
+            {
+                perf::Scope timer(perf::Timer::HEADER, perf::Timer::ACQUIRE);
+                accepted = process_header(state);
+            }
+            if (!accepted) {
+                // ✅ Skip any payload attached to a command that doesn't take one
+                if (state.expected_size > 0) {
+                    state.receiving_data = true;
+                    state.discarding = true;
+                }
+                continue;
+            }
+            if (state.expected_size > 0) {
+                continue;
+            }
+        } else {
+            size_t take = std::min(state.expected_size - state.received_size, len);
+            {
+                perf::Scope timer(perf::Timer::REASSEMBLY);
+                process_payload(state, data, take);
+            }
+            state.received_size += take;
+            data += take;
+            len -= take;
+        }
 
-    if (!recv_state.receiving_data) {
-        if (!server->process_header(server, payload, data_len)) {
-            return ERR_OK;
+        if (state.received_size >= state.expected_size) {
+            complete_message(state);
         }
-        offset = HEADER_SIZE; // ✅ Move past header
     }
+}
 
-    // ✅ Prevent buffer overflow
-    if (recv_state.recv_buffer.size() + (data_len - offset) > MAX_BUFFER_SIZE) {
-        DEBUG_PRINT("Error: Buffer overflow detected, dropping data.");
-        recv_state.recv_buffer.clear();
-        return ERR_MEM;
+void ApiServer::process_payload(RecvState &state, const uint8_t *data, size_t len) {
+    if (state.discarding) {
+        return;
     }
 
-    // ✅ Store data in reassembly buffer
-    recv_state.recv_buffer.insert(recv_state.recv_buffer.end(), payload + offset, payload + data_len);
+    if (has(state, CommandConfig::Flag::RAW_FRAME)) {
+        // ✅ Raw frames are written in place at their final offset, no reassembly needed
+        state.writer.write(data, len);
+        return;
+    }
 
-    tcp_recved(tpcb, data_len); // ✅ Acknowledge full data received
+    if (has(state, CommandConfig::Flag::REGION)) {
+        // ✅ The region header precedes the pixels and may itself be split across segments
+        if (state.region_header_received < REGION_HEADER_SIZE) {
+            size_t take = std::min(len, REGION_HEADER_SIZE - state.region_header_received);
+            std::memcpy(state.region_header + state.region_header_received, data, take);
+            state.region_header_received += take;
+            data += take;
+            len -= take;
+
+            if (state.region_header_received < REGION_HEADER_SIZE) {
+                return;
+            }
 
-    // ✅ Immediately process key-value commands
-    if (recv_state.command == CommandConfig::GET || recv_state.command == CommandConfig::SET || recv_state.command ==
-        CommandConfig::DELETE) {
-        if (recv_state.recv_buffer.size() >= recv_state.expected_size) {
-            server->process_key_value_command(server);
-            recv_state.receiving_data = false;
-            recv_state.recv_buffer.clear(); // ✅ Clear buffer after processing
+            const uint8_t *r = state.region_header;
+            state.writer.begin((r[0] << 8) | r[1], (r[2] << 8) | r[3], (r[4] << 8) | r[5], (r[6] << 8) | r[7]);
         }
-        return ERR_OK;
+        state.writer.write(data, len);
+        return;
     }
 
-    // ✅ Process image data only after all chunks are received
-    DEBUG_PRINT(
-        "Buffer: "+ std::to_string(recv_state.recv_buffer.size())+"  Expected: " + std::to_string( recv_state.
-            expected_size));
-    if (recv_state.recv_buffer.size() >= recv_state.expected_size) {
-        server->process_data();
-        recv_state.receiving_data = false;
+    if (has(state, CommandConfig::Flag::ZIPPED)) {
+        // ✅ Compressed bytes are inflated on core 1 while the rest of the frame is still in flight
+        matrix::inflate_write(data, len);
+        return;
     }
 
-    return ERR_OK;
+    state.recv_buffer.insert(state.recv_buffer.end(), data, data + len);
 }
 
-bool ApiServer::process_header(ApiServer *server, uint8_t *payload, size_t data_len) {
-    recv_state.header_buffer.insert(recv_state.header_buffer.end(), payload, payload + data_len);
+void ApiServer::complete_message(RecvState &state) {
+    if (!state.discarding) {
+        trace::log(trace::Event::MESSAGE, state.command->code, state.received_size);
+        if (carries_frame(state)) {
+            perf::add(perf::Counter::FRAMES);
+        }
+
+        // ✅ Immediately process key-value commands
+        if (has(state, CommandConfig::Flag::KEY_VALUE)) {
+            process_key_value_command(state);
+        } else {
+            process_data(state);
+        }
+    }
 
-    if (recv_state.header_buffer.size() < HEADER_SIZE) {
-        return false;
+    state.receiving_data = false;
+    state.discarding = false;
+    if (canvas_owner == &state) {
+        canvas_owner = nullptr;
     }
+}
+
+bool ApiServer::process_header(RecvState &state) {
+    uint8_t *header_data = state.header_buffer;
 
-    uint8_t *header_data = recv_state.header_buffer.data();
-    std::string header_prefix(reinterpret_cast<char *>(header_data), PREFIX_LENGTH);
+    state.expected_size = 0;
+    state.received_size = 0;
 
-    if (header_prefix != MESSAGE_PREFIX) {
-        DEBUG_PRINT("Invalid message prefix: " + header_prefix);
-        recv_state.header_buffer.clear();
+    if (std::memcmp(header_data, MESSAGE_PREFIX, PREFIX_LENGTH) != 0) {
+        trace::log(trace::Event::BAD_HEADER, (header_data[0] << 24) | (header_data[1] << 16) | (header_data[2] << 8) |
+                   header_data[3], 0);
+        perf::add(perf::Counter::BAD_HEADERS);
         return false;
     }
 
-    recv_state.expected_size = (header_data[PREFIX_LENGTH] << 24) |
+    state.expected_size = (header_data[PREFIX_LENGTH] << 24) |
                                (header_data[PREFIX_LENGTH + 1] << 16) |
                                (header_data[PREFIX_LENGTH + 2] << 8) |
                                header_data[PREFIX_LENGTH + 3];
 
-    recv_state.command = std::string(reinterpret_cast<char *>(header_data + PREFIX_LENGTH + 4), 4);
-
+    // ✅ One table lookup per message, everything after it tests flags
+    uint32_t code = (header_data[PREFIX_LENGTH + 4] << 24) | (header_data[PREFIX_LENGTH + 5] << 16) |
+                    (header_data[PREFIX_LENGTH + 6] << 8) | header_data[PREFIX_LENGTH + 7];
+    state.command = CommandConfig::find(code);
 
-    if (CommandConfig::SUPPORTED_COMMANDS.find(recv_state.command) == CommandConfig::SUPPORTED_COMMANDS.end()) {
-        DEBUG_PRINT("Unknown command: " + recv_state.command);
+    if (!state.command) {
+        trace::log(trace::Event::BAD_HEADER, code, 1);
+        perf::add(perf::Counter::BAD_HEADERS);
         return false;
     }
 
-    recv_state.received_size = 0;
-    recv_state.receiving_data = (recv_state.command == CommandConfig::DATA ||
-                                 recv_state.command == CommandConfig::SHOWDATA ||
-                                 recv_state.command == CommandConfig::ZIPPED ||
-                                 recv_state.command == CommandConfig::SHOWZIPPED ||
-                                 recv_state.command == CommandConfig::PRINT); // ✅ New case for `prnt`
+    perf::add(perf::Counter::MESSAGES);
+
+    state.discarding = false;
+    state.receiving_data = has(state, CommandConfig::Flag::PAYLOAD);
+
+    trace::log(trace::Event::HEADER, code, state.expected_size);
+
+    if (state.receiving_data) {
+        state.recv_buffer.clear();
+
+        if (has(state, CommandConfig::Flag::WRITES_CANVAS)) {
+            if (canvas_busy(&state)) {
+                // ✅ Another connection is mid-frame, drain this one rather than mixing the two
+                trace::log(trace::Event::FRAME_BUSY, code, state.expected_size);
+                if (carries_frame(state)) {
+                    perf::add(perf::Counter::FRAMES_DROPPED);
+                }
+                state.discarding = true;
+                return true;
+            }
+            canvas_owner = &state;
 
-    DEBUG_PRINT("Received command: " + recv_state.command);
-    recv_state.header_buffer.clear();
+            // ✅ Core 1 may still be reading the framebuffer
+            matrix::acquire();
+        }
 
-    if (recv_state.command == CommandConfig::GET || recv_state.command == CommandConfig::SET || recv_state.command ==
-        CommandConfig::DELETE) {
-        recv_state.receiving_data = true;
+        if (has(state, CommandConfig::Flag::RAW_FRAME)) {
+            // ✅ Packed formats are unpacked to the framebuffer layout as they arrive
+            state.writer.begin(0, 0, matrix::width(), matrix::height(), state.command->format);
+        } else if (has(state, CommandConfig::Flag::REGION)) {
+            state.region_header_received = 0;
+            state.writer.begin(0, 0, 0, 0);
+        } else if (has(state, CommandConfig::Flag::ZIPPED)) {
+            // ✅ Delta frames are XORed onto the frame currently held in the framebuffer, which holds part of
+            // another one after a frame failed to inflate. Tell the sender so it can follow with a keyframe.
+            if (has(state, CommandConfig::Flag::DELTA) && !matrix::delta_allowed()) {
+                trace::log(trace::Event::DELTA_REFUSED, code, state.expected_size);
+                perf::add(perf::Counter::FRAMES_DROPPED);
+                respond(&state, "Delta refused, send a keyframe\n");
+                canvas_owner = nullptr;
+                state.discarding = true;
+                return true;
+            }
+            matrix::inflate_begin(state.expected_size, has(state, CommandConfig::Flag::SHOWS),
+                                  has(state, CommandConfig::Flag::DELTA), state.command->format);
+        } else {
+            // ✅ Prevent buffer overflow, oversized payloads are drained and dropped
+            if (state.expected_size > MAX_BUFFER_SIZE) {
+                trace::log(trace::Event::TOO_LARGE, code, state.expected_size);
+                state.discarding = true;
+            } else {
+                state.recv_buffer.reserve(state.expected_size);
+            }
+        }
         return true; // Indicate that more data is expected
     }
 
-    if (recv_state.command == CommandConfig::RESET) {
-        matrix::print("Resetting...");
+    switch (state.command->code) {
+    case fourcc(CommandConfig::RESET):
+        show_status(&state, "Resetting...");
         sleep_ms(500);
         save_and_disable_interrupts();
         rosc_hw->ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB;
         watchdog_reboot(0, 0, 0);
         return false;
-    } else if (recv_state.command == CommandConfig::BOOTLOADER) {
-        matrix::print("Entering BOOTSEL mode...");
+    case fourcc(CommandConfig::BOOTLOADER):
+        show_status(&state, "Entering BOOTSEL mode...");
         sleep_ms(500);
         save_and_disable_interrupts();
         rosc_hw->ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB;
         reset_usb_boot(0, 0);
         return false;
-    } else if (recv_state.command == CommandConfig::FACTORY_RESET) {
-        matrix::print("Factory resetting...");
-        server->kvStore.setFactoryDefaults();
-        DEBUG_PRINT("Factory reset");
+    case fourcc(CommandConfig::FACTORY_RESET):
+        show_status(&state, "Factory resetting...");
+        state.server->kvStore.setFactoryDefaults();
         sleep_ms(500);
         save_and_disable_interrupts();
         rosc_hw->ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB;
         watchdog_reboot(0, 0, 0);
         return false;
-    } else if (recv_state.command == CommandConfig::CLEARSCREEN) {
-        matrix::clearscreen();
-        DEBUG_PRINT("Cleared display");
+    case fourcc(CommandConfig::CLEARSCREEN):
+        if (!canvas_busy(&state)) {
+            matrix::clearscreen();
+        }
+        return false;
+    case fourcc(CommandConfig::SYNC):
+        matrix::flip();
         return false;
-    } else if (recv_state.command == CommandConfig::SYNC) {
-        matrix::update();
-        DEBUG_PRINT("Display synchronized");
+    case fourcc(CommandConfig::IPV4):
+        show_status(&state, ipv4addr());
         return false;
-    } else if (recv_state.command == CommandConfig::IPV4) {
-        matrix::print(ipv4addr());
+    case fourcc(CommandConfig::IPV6):
+        show_status(&state, ipv6addr());
         return false;
-    } else if (recv_state.command == CommandConfig::IPV6) {
-        matrix::print(ipv6addr());
+    case fourcc(CommandConfig::WRITE):
+        show_status(&state, "Storing key-value store...");
+        state.server->kvStore.commitToFlash();
         return false;
-    } else if (recv_state.command == CommandConfig::WRITE) {
-        matrix::print("Storing key-value store...");
-        server->kvStore.commitToFlash();
+#if MULTIVERSE_STATS
+    case fourcc(CommandConfig::STATS):
+    case fourcc(CommandConfig::STATS_BINARY): {
+        // ✅ Answered on the connection, the display is left alone. USB sessions answer these themselves.
+        respond(&state, stats(state.command->code == fourcc(CommandConfig::STATS_BINARY)));
+        return false;
+    }
+#endif
+    case fourcc(CommandConfig::TRACE):
+        if (state.pcb) {
+            // ✅ The newest events that fit in the send buffer, the dump says how many it holds
+            std::string response(std::min<size_t>(tcp_sndbuf(state.pcb), trace::DUMP_MAX_SIZE), '\0');
+            size_t size = trace::dump(reinterpret_cast<uint8_t *>(&response[0]), response.size());
+            if (size > 0) {
+                tcp_write(state.pcb, response.data(), size, TCP_WRITE_FLAG_COPY);
+                tcp_output(state.pcb);
+            }
+        }
         return false;
     }
 
-    return recv_state.receiving_data;
+    return state.receiving_data;
 }
 
-void ApiServer::process_data() {
-    if (recv_state.recv_buffer.empty()) {
-        DEBUG_PRINT("Error: Received empty data buffer!");
+void ApiServer::process_data(RecvState &state) {
+    // ✅ An empty calibration is a request to go back to plain gamma correction, an empty overlay clear clears it all
+    if (state.received_size == 0 && state.command->code != fourcc(CommandConfig::CALIBRATION) &&
+        state.command->code != fourcc(CommandConfig::OVERLAY_CLEAR)) {
         return;
     }
 
-    DEBUG_PRINT("Processing data bytes: " + std::to_string(recv_state.recv_buffer.size()));
-
-    if (recv_state.command == CommandConfig::DATA || recv_state.command == CommandConfig::SHOWDATA) {
-        // ✅ Standard uncompressed data handling
-        size_t copy_size = std::min(recv_state.recv_buffer.size(), matrix::BUFFER_SIZE);
-        std::memcpy(matrix::buffer, recv_state.recv_buffer.data(), copy_size);
-    } else if (recv_state.command == CommandConfig::ZIPPED || recv_state.command == CommandConfig::SHOWZIPPED) {
-        // ✅ Decompression handling
-        uLongf dest_len = matrix::BUFFER_SIZE; // Maximum allowed decompressed size
-        int result = uncompress(matrix::buffer, &dest_len, recv_state.recv_buffer.data(),
-                                recv_state.recv_buffer.size());
-
-        if (result != Z_OK) {
-            DEBUG_PRINT("Error: Decompression failed with code " + std::to_string(result));
-            return;
+    if (has(state, CommandConfig::Flag::RAW_FRAME)) {
+        // ✅ Uncompressed data was already written to the framebuffer by process_payload. A whole frame
+        // replaces whatever a failed inflate left behind, deltas can follow it again.
+        if (state.writer.pixels_landed() >= static_cast<size_t>(matrix::width() * matrix::height())) {
+            matrix::keyframe_landed();
         }
-
-        DEBUG_PRINT("Decompressed size: " + std::to_string(dest_len));
-    } else if (recv_state.command == CommandConfig::PRINT) {
-        // ✅ Limit received text to 1024 characters
-        size_t copy_size = std::min(recv_state.recv_buffer.size(), static_cast<size_t>(1024));
-
-        // ✅ Convert received data to a string
-        std::string raw_message(reinterpret_cast<const char *>(recv_state.recv_buffer.data()), copy_size);
-
-        // ✅ Filter out non-printable ASCII characters
-        std::string filtered_message;
-        for (char c: raw_message) {
-            if (c >= 32 && c <= 126) {
-                // ✅ Keep only printable ASCII
-                filtered_message += c;
-            }
+    } else if (has(state, CommandConfig::Flag::REGION)) {
+        if (state.region_header_received < REGION_HEADER_SIZE) {
+            return;  // ✅ Too short for a region header
         }
+    } else if (has(state, CommandConfig::Flag::ZIPPED)) {
+        // ✅ Already inflated on core 1 as it arrived, which also commits (and shows) the frame
+        return;
+    } else if (state.command->code == fourcc(CommandConfig::PALETTE)) {
+        // ✅ Applies to indexed frames received from now on, the displayed frame is left alone
+        matrix::set_palette(state.recv_buffer.data(), state.recv_buffer.size());
+        return;
+    } else if (state.command->code == fourcc(CommandConfig::CALIBRATION)) {
+        matrix::set_calibration(state.server->kvStore, state.recv_buffer.data(), state.recv_buffer.size());
+        return;
+    } else if (state.command->code == fourcc(CommandConfig::PRINT)) {
+        std::string filtered_message = printable(state.recv_buffer.data(), state.recv_buffer.size());
 
         if (filtered_message.empty()) {
-            DEBUG_PRINT("eceived only non-printable characters, ignoring.");
             return;
         }
 
         // ✅ Print the filtered message on the display
-        matrix::print(filtered_message);
-
-        DEBUG_PRINT("Displayed filtered text");
+        show_status(&state, filtered_message);
+    } else if (state.command->code == fourcc(CommandConfig::OVERLAY_TEXT)) {
+        process_overlay_text(state);
+        return;
+    } else if (state.command->code == fourcc(CommandConfig::OVERLAY_CLEAR)) {
+        // ✅ The overlay isn't the framebuffer, a frame streaming in on another connection only delays it
+        const uint8_t *r = state.recv_buffer.data();
+        if (state.recv_buffer.size() >= REGION_HEADER_SIZE) {
+            matrix::overlay_clear((r[0] << 8) | r[1], (r[2] << 8) | r[3], (r[4] << 8) | r[5], (r[6] << 8) | r[7],
+                                  !canvas_busy(&state));
+        } else {
+            matrix::overlay_clear(0, 0, matrix::width(), matrix::height(), !canvas_busy(&state));
+        }
+        return;
     }
 
-    if (recv_state.command == CommandConfig::SHOWDATA || recv_state.command == CommandConfig::SHOWZIPPED) {
-        matrix::update();
-        DEBUG_PRINT("Image received and updated");
+    if (!has(state, CommandConfig::Flag::RAW_FRAME | CommandConfig::Flag::REGION)) {
+        return;
+    }
+    if (has(state, CommandConfig::Flag::SHOWS)) {
+        // ✅ Only the rows touched by the frame or region are converted again
+        matrix::update(state.writer.rows());
     } else {
-        DEBUG_PRINT("Image received (waiting for sync)");
+        // ✅ Convert into the back buffer now so `sync` only has to flip
+        matrix::commit(state.writer.rows());
     }
-
-    recv_state.recv_buffer.clear(); // ✅ Clear buffer after processing
 }
 
-void ApiServer::process_key_value_command(ApiServer *server) {
-    DEBUG_PRINT("Processing key-value command");
-
-    if (recv_state.recv_buffer.empty()) {
-        matrix::print("Error: Received empty key-value buffer!");
+void ApiServer::process_overlay_text(RecvState &state) {
+    if (state.recv_buffer.size() < OVERLAY_TEXT_HEADER_SIZE) {
         return;
     }
 
-    std::string data(reinterpret_cast<char *>(recv_state.recv_buffer.data()), recv_state.recv_buffer.size());
+    const uint8_t *r = state.recv_buffer.data();
+    int16_t x = static_cast<int16_t>((r[0] << 8) | r[1]);
+    int16_t y = static_cast<int16_t>((r[2] << 8) | r[3]);
+    uint32_t colour = (r[4] << 24) | (r[5] << 16) | (r[6] << 8) | r[7];
+    uint32_t background = (r[8] << 24) | (r[9] << 16) | (r[10] << 8) | r[11];
+    std::string text = printable(r + OVERLAY_TEXT_HEADER_SIZE, state.recv_buffer.size() - OVERLAY_TEXT_HEADER_SIZE);
 
-    DEBUG_PRINT("Received data: " + data);
+    matrix::overlay_text(x, y, text, colour, background, r[12], !canvas_busy(&state));
+}
+
+void ApiServer::process_key_value_command(RecvState &state) {
+    if (state.recv_buffer.empty()) {
+        show_status(&state, "Error: Received empty key-value buffer!");
+        return;
+    }
+
+    std::string data(reinterpret_cast<char *>(state.recv_buffer.data()), state.recv_buffer.size());
 
     size_t delimiter = data.find(':');
     if (delimiter == std::string::npos) {
-        matrix::print("Malformed key-value command");
+        show_status(&state, "Malformed key-value command");
         return;
     }
 
     std::string key = data.substr(0, delimiter);
     std::string value = data.substr(delimiter + 1);
 
-    if (recv_state.command == CommandConfig::GET) {
-        std::string retrieved_value = server->kvStore.getParam(key);
-        matrix::print("Get " + key + ": " + retrieved_value);
-    } else if (recv_state.command == CommandConfig::SET) {
-        matrix::print("Set " + key + " to " + value);
-        server->kvStore.setParam(key, value);
-    } else if (recv_state.command == CommandConfig::DELETE) {
-        matrix::print("Deleting key: " + key);
-        server->kvStore.deleteParam(key);
+    if (state.command->code == fourcc(CommandConfig::GET)) {
+        std::string retrieved_value = state.server->kvStore.getParam(key);
+        show_status(&state, "Get " + key + ": " + retrieved_value);
+    } else if (state.command->code == fourcc(CommandConfig::SET)) {
+        show_status(&state, "Set " + key + " to " + value);
+        state.server->kvStore.setParam(key, value);
+        // ✅ Applied right away unless another connection is drawing, then from the next boot
+        if (key == "brightness" && !canvas_busy(&state)) {
+            matrix::set_brightness(std::atoi(value.c_str()));
+        }
+    } else if (state.command->code == fourcc(CommandConfig::DELETE)) {
+        show_status(&state, "Deleting key: " + key);
+        state.server->kvStore.deleteParam(key);
     }
 }
 
-void ApiServer::reset_recv_state() {
-    recv_state.receiving_data = false;
-    recv_state.expected_size = 0;
-    recv_state.received_size = 0;
-    recv_state.command.clear();
-    recv_state.header_buffer.clear();
+void ApiServer::reset_recv_state(RecvState &state) {
+    if (state.receiving_data && !state.discarding && carries_frame(state)) {
+        perf::add(perf::Counter::FRAMES_DROPPED);
+        trace::log(trace::Event::FRAME_CUT, state.command->code, state.received_size);
+    }
+    if (state.receiving_data && !state.discarding && has(state, CommandConfig::Flag::ZIPPED)) {
+        matrix::inflate_abort(); // ✅ Sender went away mid-frame, release core 1
+    }
+
+    state.receiving_data = false;
+    state.expected_size = 0;
+    state.received_size = 0;
+    state.discarding = false;
+    state.command = nullptr;
+    state.header_received = 0;
+    if (canvas_owner == &state) {
+        canvas_owner = nullptr;
+    }
 }
 
 void ApiServer::on_error(void *arg, err_t err) {
-    DEBUG_PRINT("TCP error: " + std::to_string(err));
+    auto *state = static_cast<RecvState *>(arg);
+    trace::log(trace::Event::TCP_ERROR, state ? slot_of(state) : LISTENER_SLOT, static_cast<uint32_t>(err));
+    if (!state) return;
+
+    // ✅ The pcb is already freed (reset or keepalive timeout), drop its partial message and slot
+    reset_recv_state(*state);
+    state->pcb = nullptr;
 }
 
+RecvState *ApiServer::open_session(SessionReply reply, void *context) {
+    for (RecvState &slot: sessions) {
+        if (!slot.server) {
+            slot.server = this;
+            slot.reply = reply;
+            slot.reply_context = context;
+            reset_recv_state(slot);
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+// ✅ Called from the main loop, lwIP callbacks touch the same connection and framebuffer state
+void ApiServer::feed_session(RecvState *state, const uint8_t *data, size_t len) {
+    if (!state) return;
+
+    cyw43_arch_lwip_begin();
+    ingest(*state, data, len);
+    cyw43_arch_lwip_end();
+}
+
+void ApiServer::reset_session(RecvState *state) {
+    if (!state) return;
+
+    cyw43_arch_lwip_begin();
+    reset_recv_state(*state);
+    cyw43_arch_lwip_end();
+}
+
+uint8_t *ApiServer::session_window(RecvState *state, size_t &len) {
+    if (!state || !state->receiving_data || state->discarding || !has(*state, CommandConfig::Flag::RAW_FRAME)) {
+        return nullptr;
+    }
+    len = std::min(len, state->expected_size - state->received_size);
+    return state->writer.window(len);
+}
+
+void ApiServer::session_received_in_place(RecvState *state, size_t len) {
+    cyw43_arch_lwip_begin();
+    perf::add(perf::Counter::BYTES, len);
+    state->writer.wrote_in_place(len);
+    state->received_size += len;
+    if (state->received_size >= state->expected_size) {
+        complete_message(*state);
+    }
+    cyw43_arch_lwip_end();
+}
+
+#if MULTIVERSE_STATS
+// ✅ lwIP keeps its own counters, they are copied in whenever the stats are read
+static void sample_lwip_stats() {
+    uint32_t memp_err = 0;
+    for (int i = 0; i < MEMP_MAX; i++) {
+        if (lwip_stats.memp[i]) {
+            memp_err += lwip_stats.memp[i]->err;
+        }
+    }
+    perf::set(perf::Counter::MEM_ERR, lwip_stats.mem.err);
+    perf::set(perf::Counter::PBUF_POOL_ERR, lwip_stats.memp[MEMP_PBUF_POOL] ? lwip_stats.memp[MEMP_PBUF_POOL]->err : 0);
+    perf::set(perf::Counter::MEMP_ERR, memp_err);
+    perf::set(perf::Counter::TCP_DROP, lwip_stats.tcp.drop);
+}
+
+std::string ApiServer::stats(bool binary) {
+    sample_lwip_stats();
+    if (!binary) {
+        return perf::json();
+    }
+
+    std::string response(perf::BINARY_SIZE, '\0');
+    perf::binary(reinterpret_cast<uint8_t *>(&response[0]));
+    return response;
+}
+#endif
+
 struct udp_pcb *udp_sync_pcb = nullptr;
 
 void ApiServer::setup_multicast_listener() {
@@ -485,32 +971,287 @@ void ApiServer::setup_multicast_listener() {
     matrix::print("Listening for multicast sync on " + multicast_ip + ":" + std::to_string(multicast_port));
 }
 
+// Fragment layout, all big endian:
+//   "mvfr" | frame id (4) | byte offset (4) | frame size (4) | fragment index (2) | fragment count (2) |
+//   flags (1) | pixel format (1) | reserved (2) | [canvas width (2) | canvas height (2)] |
+//   [presentation time (8)] | pixels
+// Fragments may arrive in any order but must start on a whole pixel. A fragment of a newer frame
+// drops the incomplete one, fragments of older frames are counted as late.
+// Without the canvas flag a frame covers exactly this panel. With it the frame is a larger canvas
+// multicast to every panel at once; each one keeps the region at its canvas_x/canvas_y and is done
+// as soon as the fragments covering that region are in, whatever happens to the rest.
+// A timed frame is committed when complete and presented at its host clock time, see clock sync.
+void ApiServer::process_udp_frame(ApiServer *server, struct pbuf *p) {
+    uint8_t header[UDP_FRAME_HEADER_SIZE + UDP_CANVAS_HEADER_SIZE + UDP_TIMED_HEADER_SIZE];
+    pbuf_copy_partial(p, header, UDP_FRAME_HEADER_SIZE, 0);
+
+    auto be32 = [&](int at) {
+        return (uint32_t(header[at]) << 24) | (uint32_t(header[at + 1]) << 16) | (header[at + 2] << 8) | header[at + 3];
+    };
+    uint32_t frame_id = be32(4);
+    uint32_t offset = be32(8);
+    uint32_t total_size = be32(12);
+    uint16_t index = (header[16] << 8) | header[17];
+    uint16_t count = (header[18] << 8) | header[19];
+    uint8_t flags = header[20];
+    uint8_t format = header[21];
+
+    size_t header_size = UDP_FRAME_HEADER_SIZE + (flags & UDP_FLAG_CANVAS ? UDP_CANVAS_HEADER_SIZE : 0) +
+                         (flags & UDP_FLAG_TIMED ? UDP_TIMED_HEADER_SIZE : 0);
+    if (p->tot_len < header_size) {
+        udp_frame.fragments_rejected++;
+        return;
+    }
+    pbuf_copy_partial(p, header + UDP_FRAME_HEADER_SIZE, header_size - UDP_FRAME_HEADER_SIZE, UDP_FRAME_HEADER_SIZE);
+    const uint8_t *extension = header + UDP_FRAME_HEADER_SIZE;
+
+    uint16_t canvas_width = matrix::width();
+    uint16_t canvas_height = matrix::height();
+    uint16_t origin_x = 0;
+    uint16_t origin_y = 0;
+    if (flags & UDP_FLAG_CANVAS) {
+        canvas_width = (extension[0] << 8) | extension[1];
+        canvas_height = (extension[2] << 8) | extension[3];
+        origin_x = server->canvas_x;
+        origin_y = server->canvas_y;
+        extension += UDP_CANVAS_HEADER_SIZE;
+    }
+    uint64_t present_at = flags & UDP_FLAG_TIMED ? get_be64(extension) : 0;
+    size_t len = p->tot_len - header_size;
+
+    static const uint8_t bytes_per_pixel[] = {4, 3, 2, 1, 1};
+    if (format > static_cast<uint8_t>(matrix::PixelFormat::INDEX4)) {
+        udp_frame.fragments_rejected++;
+        return;
+    }
+    // ✅ In 64 bits: a 65535 x 65535 canvas of 4 byte pixels, or an offset near 4 GiB, wraps a 32 bit size_t
+    uint64_t canvas_pixels = static_cast<uint64_t>(canvas_width) * canvas_height;
+    uint64_t canvas_size = format == static_cast<uint8_t>(matrix::PixelFormat::INDEX4)
+                               ? (canvas_pixels + 1) / 2
+                               : canvas_pixels * bytes_per_pixel[format];
+
+    // ✅ The part of the canvas this panel shows, a panel outside the canvas has nothing to wait for
+    size_t visible_width = origin_x < canvas_width ? std::min<size_t>(canvas_width - origin_x, matrix::width()) : 0;
+    size_t visible_height = origin_y < canvas_height ? std::min<size_t>(canvas_height - origin_y, matrix::height()) : 0;
+
+    if (total_size != canvas_size || visible_width * visible_height == 0 ||
+        count == 0 || count > UDP_MAX_FRAGMENTS || index >= count || static_cast<uint64_t>(offset) + len > total_size ||
+        offset % bytes_per_pixel[format] != 0) {
+        udp_frame.fragments_rejected++;
+        return;
+    }
+
+    if (!udp_frame.active || frame_id != udp_frame.frame_id) {
+        int32_t age = static_cast<int32_t>(udp_frame.frame_id - frame_id);
+        if (udp_frame.seen && age >= 0 && age < UDP_FRAME_ID_WINDOW) {
+            udp_frame.fragments_late++;
+            return;
+        }
+
+        // ✅ A newer frame: give up on the incomplete one rather than waiting for it
+        if (udp_frame.active) {
+            abandon_udp_frame();
+        }
+        if (canvas_owner) {
+            udp_frame.fragments_rejected++;  // ✅ A TCP frame is streaming in
+            return;
+        }
+
+        canvas_owner = &udp_frame;
+        matrix::acquire();
+
+        udp_frame.active = true;
+        udp_frame.seen = true;
+        udp_frame.frame_id = frame_id;
+        udp_frame.total_size = total_size;
+        udp_frame.fragment_count = count;
+        udp_frame.pixels_needed = visible_width * visible_height;
+        udp_frame.flags = flags;
+        udp_frame.format = static_cast<matrix::PixelFormat>(format);
+        udp_frame.present_at = present_at;
+        std::memset(udp_frame.received, 0, sizeof(udp_frame.received));
+        udp_frame.writer.begin(-origin_x, -origin_y, canvas_width, canvas_height, udp_frame.format,
+                               udp_frame.landed);
+    }
+
+    udp_frame.last_fragment_us = time_us_32();
+
+    uint32_t bit = 1u << (index % 32);
+    if (count != udp_frame.fragment_count || total_size != udp_frame.total_size || flags != udp_frame.flags ||
+        format != static_cast<uint8_t>(udp_frame.format)) {
+        udp_frame.fragments_rejected++;  // ✅ Disagrees with the rest of its frame
+        return;
+    }
+    if (udp_frame.received[index / 32] & bit) {
+        udp_frame.fragments_late++;  // ✅ Duplicate
+        return;
+    }
+    udp_frame.received[index / 32] |= bit;
+
+    // ✅ Write the pixels where they belong, walking the pbuf chain past the header. Canvas pixels
+    // outside this panel's region are skipped by the writer.
+    perf::add(perf::Counter::BYTES, p->tot_len);
+    udp_frame.writer.seek(offset);
+    size_t skip = header_size;
+    for (struct pbuf *q = p; q != nullptr; q = q->next) {
+        if (skip >= q->len) {
+            skip -= q->len;
+            continue;
+        }
+        udp_frame.writer.write(static_cast<const uint8_t *>(q->payload) + skip, q->len - skip);
+        skip = 0;
+    }
+
+    if (udp_frame.writer.pixels_landed() < udp_frame.pixels_needed) {
+        return;
+    }
+
+    trace::log(trace::Event::UDP_FRAME, udp_frame.frame_id, udp_frame.fragment_count);
+    udp_frame.active = false;
+    udp_frame.frames_completed++;
+    perf::add(perf::Counter::FRAMES);
+    canvas_owner = nullptr;
+    if (udp_frame.pixels_needed == static_cast<uint32_t>(matrix::width() * matrix::height())) {
+        matrix::keyframe_landed();  // ✅ Covers the whole panel
+    }
+    if (udp_frame.flags & UDP_FLAG_TIMED) {
+        matrix::commit(udp_frame.writer.rows());
+        present_at_host_time(udp_frame.present_at);
+    } else if (udp_frame.flags & UDP_FLAG_SHOW) {
+        matrix::update(udp_frame.writer.rows());
+    } else {
+        matrix::commit(udp_frame.writer.rows());
+    }
+}
+
+// ✅ Answered straight from the receive callback so t2 and t3 are as close to the wire as we get
+void ApiServer::process_clock_request(struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port,
+                                      uint64_t received_us) {
+    uint8_t request[CLOCK_REQUEST_SIZE];
+    pbuf_copy_partial(p, request, CLOCK_REQUEST_SIZE, 0);
+
+    pbuf *reply = pbuf_alloc(PBUF_TRANSPORT, CLOCK_REPLY_SIZE, PBUF_RAM);
+    if (!reply) {
+        clock_sync.samples_rejected++;
+        return;
+    }
+
+    uint8_t *data = static_cast<uint8_t *>(reply->payload);
+    std::memcpy(data, CLOCK_REPLY_MAGIC, 4);
+    std::memcpy(data + 4, request + 4, 12);  // ✅ Sequence number and t1, echoed
+    put_be64(data + 16, received_us);
+    put_be64(data + 24, time_us_64());
+    udp_sendto(upcb, reply, addr, port);
+    pbuf_free(reply);
+}
+
+// ✅ Keeps the last few exchanges and trusts the one with the shortest round trip: queueing
+// delays only ever lengthen a trip, and an asymmetric one skews the offset by half the difference
+void ApiServer::process_clock_result(struct pbuf *p) {
+    uint8_t result[CLOCK_RESULT_SIZE];
+    pbuf_copy_partial(p, result, CLOCK_RESULT_SIZE, 0);
+
+    int64_t t1 = static_cast<int64_t>(get_be64(result + 8));
+    int64_t t2 = static_cast<int64_t>(get_be64(result + 16));
+    int64_t t3 = static_cast<int64_t>(get_be64(result + 24));
+    int64_t t4 = static_cast<int64_t>(get_be64(result + 32));
+
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    bool kept = delay >= 0 && delay <= CLOCK_MAX_DELAY_US;
+    trace::log(trace::Event::CLOCK_SAMPLE, static_cast<uint32_t>(delay), kept);
+    if (!kept) {
+        clock_sync.samples_rejected++;
+        return;
+    }
+
+    clock_sync.samples[clock_sync.sample_count % CLOCK_FILTER_SIZE] = {((t2 - t1) + (t3 - t4)) / 2,
+                                                                       static_cast<uint32_t>(delay)};
+    clock_sync.sample_count++;
+
+    size_t count = std::min<size_t>(clock_sync.sample_count, CLOCK_FILTER_SIZE);
+    const ClockSample *best = &clock_sync.samples[0];
+    for (size_t i = 1; i < count; i++) {
+        if (clock_sync.samples[i].delay_us < best->delay_us) {
+            best = &clock_sync.samples[i];
+        }
+    }
+    clock_sync.offset_us = best->offset_us;
+    clock_sync.delay_us = best->delay_us;
+
+    uint64_t spread = 0;
+    for (size_t i = 0; i < count; i++) {
+        int64_t distance = clock_sync.samples[i].offset_us - clock_sync.offset_us;
+        spread += distance < 0 ? -distance : distance;
+    }
+    clock_sync.jitter_us = spread / count;
+}
+
 void ApiServer::on_multicast_receive(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr,
                                      u16_t port) {
     if (!p) return;
 
+    uint64_t received_us = time_us_64();  // ✅ Clock sync wants the arrival time before anything else runs
+
     // ✅ Get the actual ApiServer instance from `arg`
     ApiServer *server = static_cast<ApiServer *>(arg);
 
-    DEBUG_PRINT("Received multicast data");
+    // ✅ Binary messages, recognised by their four byte magic
+    if (p->len >= 4) {
+        bool handled = true;
+        if (p->tot_len >= UDP_FRAME_HEADER_SIZE && std::memcmp(p->payload, UDP_FRAME_MAGIC, 4) == 0) {
+            process_udp_frame(server, p);
+        } else if (p->tot_len >= CLOCK_REQUEST_SIZE && std::memcmp(p->payload, CLOCK_REQUEST_MAGIC, 4) == 0) {
+            process_clock_request(upcb, p, addr, port, received_us);
+        } else if (p->tot_len >= CLOCK_RESULT_SIZE && std::memcmp(p->payload, CLOCK_RESULT_MAGIC, 4) == 0) {
+            process_clock_result(p);
+        } else if (p->tot_len >= PRESENT_SIZE && std::memcmp(p->payload, PRESENT_MAGIC, 4) == 0) {
+            uint8_t present[PRESENT_SIZE];
+            pbuf_copy_partial(p, present, PRESENT_SIZE, 0);
+            present_at_host_time(get_be64(present + 4));
+        } else {
+            handled = false;
+        }
+
+        if (handled) {
+            pbuf_free(p);
+            return;
+        }
+    }
 
     std::string received_data(static_cast<char *>(p->payload), p->len);
     pbuf_free(p);
 
     if (received_data == CommandConfig::SYNC) {
-        matrix::update();
-        DEBUG_PRINT("Sync command received via multicast");
+        matrix::flip();
     } else if (received_data == CommandConfig::DISCOVERY) {
         // ✅ New discovery feature
-        matrix::print("Discovery request received");
+        show_status(nullptr, "Discovery request received");
 
         // ✅ Access kvStore via `server->kvStore`
-        std::string response = R"({ "width": )" + std::to_string(matrix::WIDTH) + R"(, )" +
-                               R"("height": )" + std::to_string(matrix::HEIGHT) + R"(, )" +
+        matrix::PresentStats presents = matrix::present_stats();
+        std::string response = R"({ "width": )" + std::to_string(matrix::width()) + R"(, )" +
+                               R"("height": )" + std::to_string(matrix::height()) + R"(, )" +
                                R"("rotation": )" + std::to_string(server->rotation) + R"(, )" +
                                R"("order": )" + std::to_string(server->order) + R"(, )" +
+                               R"("canvas_x": )" + std::to_string(server->canvas_x) + R"(, )" +
+                               R"("canvas_y": )" + std::to_string(server->canvas_y) + R"(, )" +
                                R"("ip_address": ")" + server->ipv4addr() + R"(", )" +
                                R"("port": )" + std::to_string(server->port) + R"(, )" +
+                               R"("udp_frames": )" + std::to_string(udp_frame.frames_completed) + R"(, )" +
+                               R"("udp_dropped": )" + std::to_string(udp_frame.frames_dropped) + R"(, )" +
+                               R"("udp_late": )" + std::to_string(udp_frame.fragments_late) + R"(, )" +
+                               R"("udp_rejected": )" + std::to_string(udp_frame.fragments_rejected) + R"(, )" +
+                               R"("clock_samples": )" + std::to_string(clock_sync.sample_count) + R"(, )" +
+                               R"("clock_offset_us": )" + std::to_string(clock_sync.offset_us) + R"(, )" +
+                               R"("clock_delay_us": )" + std::to_string(clock_sync.delay_us) + R"(, )" +
+                               R"("clock_jitter_us": )" + std::to_string(clock_sync.jitter_us) + R"(, )" +
+                               R"("present_timed": )" + std::to_string(presents.presents) + R"(, )" +
+                               R"("present_untimed": )" + std::to_string(clock_sync.presents_untimed) + R"(, )" +
+                               R"("present_late_us": )" + std::to_string(presents.late_us) + R"(, )" +
+                               R"("present_late_max_us": )" + std::to_string(presents.max_late_us) + R"(, )" +
+#if MULTIVERSE_STATS
+                               R"("stats": )" + stats(false) + R"(, )" +
+#endif
                                R"("build": ")" + BUILD_NUMBER + R"(" })";
 
         pbuf *response_pbuf = pbuf_alloc(PBUF_TRANSPORT, response.size(), PBUF_RAM);
@@ -529,6 +1270,6 @@ void ApiServer::on_multicast_receive(void *arg, struct udp_pcb *upcb, struct pbu
             DEBUG_PRINT("Failed to send multicast response, error: " + std::to_string(send_err));
         }
 
-        matrix::print("Sent discovery response: " + response);
+        show_status(nullptr, "Sent discovery response: " + response);
     }
 }
@@ -14,6 +14,8 @@ constexpr char MESSAGE_PREFIX[] = "multiverse:";  // ✅ Defined prefix
 constexpr size_t PREFIX_LENGTH = sizeof(MESSAGE_PREFIX) - 1;  // ✅ Exclude null terminator
 constexpr size_t HEADER_SIZE = PREFIX_LENGTH + 8;  // ✅ Includes 4-byte size + 4-char command
 
+struct RecvState;
+
 class ApiServer {
 public:
     explicit ApiServer(KVStore& kvStore);
@@ -24,6 +26,25 @@ public:
     static std::string ipv4addr();
     static std::string ipv6addr();
 
+    // Sessions for links outside lwIP (USB): a stream framed like a TCP connection, handled by the same parser
+    // and sharing the framebuffer with the network clients. Feed bytes in any split; reset drops a partial message.
+    // Sessions come from a fixed pool, open_session returns nullptr once it is used up. `reply` sends answers
+    // (such as status text that can't be shown while another client owns the canvas) back over the link.
+    using SessionReply = void (*)(void* context, const uint8_t* data, size_t len);
+    RecvState* open_session(SessionReply reply = nullptr, void* context = nullptr);
+    static void feed_session(RecvState* state, const uint8_t* data, size_t len);
+    static void reset_session(RecvState* state);
+    // Where the next payload bytes of a session's raw frame go in the framebuffer, at most `len` of them, so the
+    // link can read them straight there; nullptr while the bytes need parsing or unpacking. Report what was
+    // read there with session_received_in_place instead of feeding it.
+    static uint8_t* session_window(RecvState* state, size_t& len);
+    static void session_received_in_place(RecvState* state, size_t len);
+
+#if MULTIVERSE_STATS
+    // Counters and timers from perf (lwIP's included) as JSON, or laid out as perf::binary() does
+    static std::string stats(bool binary);
+#endif
+
 private:
     KVStore& kvStore;  // Store reference to KVStore
     std::string ssid;
@@ -34,6 +55,9 @@ private:
     uint16_t brightness;
     uint16_t rotation;
     uint16_t order;
+    uint16_t canvas_x;
+    uint16_t canvas_y;
+    uint16_t max_connections;
     tcp_pcb* server_pcb;
     std::vector<uint8_t> recv_buffer;
     size_t expected_message_size = 0;
@@ -48,13 +72,21 @@ private:
     void run();
 
     // Private methods for handling data
-    static bool process_header(ApiServer* server, uint8_t* payload, size_t data_len);
-    static void process_data();
-    static void reset_recv_state();
-    static void process_key_value_command(ApiServer* server);  // New method to handle `get:`, `set:`, `del:`
+    static void ingest(RecvState& state, const uint8_t* data, size_t len);
+    static bool process_header(RecvState& state);
+    static void process_payload(RecvState& state, const uint8_t* data, size_t len);
+    static void complete_message(RecvState& state);
+    static void process_data(RecvState& state);
+    static void reset_recv_state(RecvState& state);
+    static void process_overlay_text(RecvState& state);
+    static void process_key_value_command(RecvState& state);  // New method to handle `get:`, `set:`, `del:`
     // void udp_recv(struct udp_pcb * pcb, void(TcpServer::* recv)(void *arg, struct udp_pcb *upcb, struct pbuf *p, const ip_addr_t *addr, u16_t port), TcpServer * tcp_server);
 
     void setup_multicast_listener();
+    static void process_udp_frame(ApiServer* server, struct pbuf* p);
+    static void process_clock_request(struct udp_pcb* upcb, struct pbuf* p, const ip_addr_t* addr, u16_t port,
+                                      uint64_t received_us);
+    static void process_clock_result(struct pbuf* p);
     static void on_multicast_receive(void* arg, struct udp_pcb* upcb, struct pbuf* p, const ip_addr_t* addr, u16_t port);
 };
 
@@ -0,0 +1,85 @@
+#include "trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include "pico/stdlib.h"
+
+#define DUMP_MAGIC "mvtl"
+#define DUMP_VERSION 1
+
+namespace trace {
+    struct Entry {
+        uint32_t time_us;
+        std::atomic<uint32_t> sequence;  // ✅ Index + 1, stored last: a reader skips entries still being written
+        uint8_t event;
+        uint8_t core;
+        uint32_t a;
+        uint32_t b;
+    };
+
+    static_assert((ENTRIES & (ENTRIES - 1)) == 0, "ENTRIES must be a power of two");
+
+    static Entry entries[ENTRIES];
+    static std::atomic<uint32_t> next{0};
+
+    void log(Event event, uint32_t a, uint32_t b) {
+        // ✅ Claiming a slot is the only shared write, cores and interrupts never wait on each other
+        uint32_t index = next.fetch_add(1, std::memory_order_relaxed);
+        Entry& entry = entries[index & (ENTRIES - 1)];
+        entry.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        entry.time_us = time_us_32();
+        entry.event = static_cast<uint8_t>(event);
+        entry.core = get_core_num();
+        entry.a = a;
+        entry.b = b;
+        entry.sequence.store(index + 1, std::memory_order_release);
+    }
+
+    static uint8_t* put_be(uint8_t* out, uint32_t value, int bytes) {
+        for (int i = bytes - 1; i >= 0; i--) {
+            out[i] = value & 0xff;
+            value >>= 8;
+        }
+        return out + bytes;
+    }
+
+    size_t dump(uint8_t* out, size_t capacity) {
+        if (capacity < DUMP_HEADER_SIZE) return 0;
+
+        uint32_t end = next.load(std::memory_order_acquire);
+        uint32_t count = std::min<size_t>({end, ENTRIES, (capacity - DUMP_HEADER_SIZE) / DUMP_ENTRY_SIZE});
+
+        uint8_t* p = out + DUMP_HEADER_SIZE;
+        uint32_t written = 0;
+        for (uint32_t index = end - count; index != end; index++) {
+            const Entry& entry = entries[index & (ENTRIES - 1)];
+            if (entry.sequence.load(std::memory_order_acquire) != index + 1) {
+                continue;  // ✅ Overwritten or still being written
+            }
+            uint8_t* start = p;
+            p = put_be(p, entry.time_us, 4);
+            p = put_be(p, index + 1, 2);
+            *p++ = entry.event;
+            *p++ = entry.core;
+            p = put_be(p, entry.a, 4);
+            p = put_be(p, entry.b, 4);
+
+            // ✅ Checked again once copied, a writer may have lapped the ring meanwhile
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (entry.sequence.load(std::memory_order_relaxed) != index + 1) {
+                p = start;
+                continue;
+            }
+            written++;
+        }
+
+        std::copy(DUMP_MAGIC, DUMP_MAGIC + 4, out);
+        out[4] = DUMP_VERSION;
+        out[5] = DUMP_ENTRY_SIZE;
+        out[6] = 0;
+        out[7] = 0;
+        put_be(out + 8, written, 4);
+        put_be(out + 12, time_us_32(), 4);
+        return p - out;
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size binary event log, cheap enough to leave on in release builds and safe to write from either
+// core and from interrupts: an event is an id, a time_us_32() stamp and two arguments, never a string.
+// The newest ENTRIES events are kept; dump() lays them out for the host (see `trce` in matrix.py).
+namespace trace {
+    enum class Event : uint8_t {
+        CONNECT,            // a: connection slot
+        DISCONNECT,         // a: connection slot
+        TCP_ERROR,          // a: connection slot (all ones for the listener), b: lwIP error
+        REFUSED,            // a: open connections
+        HEADER,             // a: command, b: payload size
+        BAD_HEADER,         // a: first 4 bytes of the header (prefix) or command (unknown), b: 0 or 1 for which
+        MESSAGE,            // a: command, b: payload bytes, handled in full
+        FRAME_BUSY,         // a: command, b: payload size; drained, another frame holds the framebuffer
+        FRAME_CUT,          // a: command, b: payload bytes received before the sender went away
+        TOO_LARGE,          // a: command, b: payload size; drained
+        UDP_FRAME,          // a: frame id, b: fragments
+        UDP_DROPPED,        // a: frame id, b: fragments received
+        USB_ABANDON,        // a: 0 CDC, 1 vendor, b: parser state
+        INFLATE,            // a: compressed size, b: 1 if it inflated to a whole frame (core 1)
+        COMMIT,             // a: rows converted, low 32, b: high 32 (core 1)
+        FLIP,               // a: microseconds after its deadline for a timed flip, b: 1 if timed (core 1 interrupt)
+        ACQUIRE,            // a: microseconds core 0 waited for core 1
+        CLOCK_SAMPLE,       // a: round trip in microseconds, b: 1 if kept
+        DELTA_REFUSED,      // a: command, b: payload size; drained, no keyframe since a frame failed to inflate
+        COUNT
+    };
+
+    void log(Event event, uint32_t a = 0, uint32_t b = 0);
+
+    // "mvtl", version, entry size, two reserved bytes, entry count, time_us_32() of the dump, all big endian,
+    // then the entries, oldest first: time (4), sequence number (2), event (1), core (1), a (4), b (4)
+    const size_t ENTRIES = 512;  // Kept, a power of two
+    const size_t DUMP_HEADER_SIZE = 16;
+    const size_t DUMP_ENTRY_SIZE = 16;
+    const size_t DUMP_MAX_SIZE = DUMP_HEADER_SIZE + ENTRIES * DUMP_ENTRY_SIZE;
+
+    // Writes as many of the newest events as fit in `capacity` bytes, returns the bytes written
+    size_t dump(uint8_t* out, size_t capacity);
+}
+
+#endif // TRACE_HPP
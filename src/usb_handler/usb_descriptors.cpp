@@ -64,15 +64,15 @@ enum
 {
   ITF_NUM_CDC_COM,
   ITF_NUM_CDC_DATA,
-  ITF_NUM_PROBE,
+  ITF_NUM_FRAMES,
   ITF_NUM_TOTAL
 };
 
 #define CDC_NOTIFICATION_EP_NUM 0x81
 #define CDC_DATA_OUT_EP_NUM 0x02
 #define CDC_DATA_IN_EP_NUM 0x83
-#define PROBE_OUT_EP_NUM 0x04
-#define PROBE_IN_EP_NUM 0x85
+#define FRAMES_OUT_EP_NUM 0x04
+#define FRAMES_IN_EP_NUM 0x85
 
 #define CONFIG_TOTAL_LEN  (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN + TUD_VENDOR_DESC_LEN)
 
@@ -83,8 +83,8 @@ uint8_t const desc_configuration[] =
   // Interface 0 + 1
   TUD_CDC_DESCRIPTOR(ITF_NUM_CDC_COM, 0, CDC_NOTIFICATION_EP_NUM, 64, CDC_DATA_OUT_EP_NUM, CDC_DATA_IN_EP_NUM, 64),
 
-  // Interface 2
-  TUD_VENDOR_DESCRIPTOR(ITF_NUM_PROBE, 0, PROBE_OUT_EP_NUM, PROBE_IN_EP_NUM, 64)
+  // Interface 2: vendor bulk, the same commands as CDC without the serial class overhead
+  TUD_VENDOR_DESCRIPTOR(ITF_NUM_FRAMES, 4, FRAMES_OUT_EP_NUM, FRAMES_IN_EP_NUM, 64)
 
 };
 
@@ -108,6 +108,7 @@ char const* string_desc_arr [] =
   "ESP",
   "Multiverse",
   usb_serial,
+  "Multiverse frames",
 };
 
 static uint16_t _desc_str[32];
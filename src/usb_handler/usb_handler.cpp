@@ -1,10 +1,7 @@
 #include "usb_handler.hpp"
-#include "pico/bootrom.h"
-#include "hardware/structs/rosc.h"
-#include "hardware/watchdog.h"
-#include "pico/timeout_helper.h"
+#include <algorithm>
+#include <cstring>
 #include "command_config.hpp"
-#include "zlib.h"
 #include "bsp/board.h"
 #include "tusb.h"
 #include "cdc_uart.h"
@@ -13,10 +10,36 @@
 #include "config_storage.hpp"
 #include "buildinfo.h"
 #include "server.hpp"
+#include "trace.hpp"
+
+using CommandConfig::fourcc;
 
 #define COMMAND_LEN 4
 #define CONFIG_KEY_LEN 16
 #define CONFIG_VALUE_LEN 128
+#define TEXT_LEN 1024
+#define CHUNK_SIZE 4096
+#define ZIP_SIZE_LEN 4               // ✅ Compressed size, little endian, ahead of zipped data
+#define REGION_LEN 8                 // ✅ x, y, width, height as 16 bit big endian, ahead of region pixels
+#define OVERLAY_LEN 13               // ✅ Position, colours and scale, ahead of overlay text
+#define USB_MESSAGE_TIMEOUT_US 1000000  // ✅ A message stalled this long is dropped and the framebuffer released
+
+static uint8_t chunk[CHUNK_SIZE];
+
+// ✅ Frames sent over USB are always shown on arrival, forwarded as the TCP command that does the same
+struct UsbFrameCommand {
+    uint32_t code;
+    uint32_t forward_as;
+    size_t bits_per_pixel;
+};
+
+static const UsbFrameCommand USB_FRAME_COMMANDS[] = {
+    {fourcc(CommandConfig::DATA), fourcc(CommandConfig::SHOWDATA), 32},
+    {fourcc(CommandConfig::DATA888), fourcc(CommandConfig::SHOWDATA888), 24},
+    {fourcc(CommandConfig::DATA565), fourcc(CommandConfig::SHOWDATA565), 16},
+    {fourcc(CommandConfig::INDEX8), fourcc(CommandConfig::SHOWINDEX8), 8},
+    {fourcc(CommandConfig::INDEX4), fourcc(CommandConfig::SHOWINDEX4), 4},
+};
 
 void usb_serial_write(const std::string& message) {
     if (!tud_cdc_connected()) {
@@ -31,53 +54,204 @@ void usb_serial_write(const std::string& message) {
 UsbHandler::UsbHandler(KVStore& kvStore, ApiServer& api_server) : kvStore(kvStore), api_server(api_server) {
     usb_serial_init();
     tusb_init();
+    for (Link* link : {&cdc, &vendor}) {
+        link->handler = this;
+        link->session = api_server.open_session(session_reply, link);
+    }
 }
 
 void UsbHandler::start() {
     while (1) {
         tud_task();
+        poll();
+    }
+}
+
+void UsbHandler::poll() {
+    receive(cdc, [](uint8_t* data, size_t len) -> size_t { return cdc_task(data, len); });
+    receive(vendor, [](uint8_t* data, size_t len) -> size_t { return tud_vendor_read(data, len); });
 
-        if (!waitFor("multiverse:")) {
-            continue;
+    uint32_t now = time_us_32();
+    for (Link* link : {&cdc, &vendor}) {
+        bool idle = link->state == Link::State::PREFIX && link->matched == 0;
+        if (!idle && now - link->last_byte_us > USB_MESSAGE_TIMEOUT_US) {
+            abandon(*link);
         }
+    }
+}
 
-        uint8_t command_buffer[COMMAND_LEN];
-        if (getBytes(command_buffer, COMMAND_LEN) != COMMAND_LEN) {
-            continue;
+// ✅ Takes whatever the endpoint FIFO holds in one copy, not a byte or a packet at a time. Raw frame pixels are
+// copied straight to their place in the framebuffer, the rest goes through `chunk` to the parser.
+void UsbHandler::receive(Link& link, size_t (*read)(uint8_t* data, size_t len)) {
+    if (link.state == Link::State::PAYLOAD) {
+        size_t len = link.remaining;
+        uint8_t* window = ApiServer::session_window(link.session, len);
+        if (window) {
+            size_t bytes_read = read(window, len);
+            if (bytes_read > 0) {
+                link.last_byte_us = time_us_32();
+                ApiServer::session_received_in_place(link.session, bytes_read);
+                link.remaining -= bytes_read;
+                if (link.remaining == 0) {
+                    link.state = Link::State::PREFIX;
+                }
+            }
+            return;
         }
+    }
 
-        std::string command(reinterpret_cast<char*>(command_buffer), COMMAND_LEN);
-        processCommand(command);
+    size_t bytes_read = read(chunk, CHUNK_SIZE);
+    if (bytes_read > 0) {
+        consume(link, chunk, bytes_read);
     }
 }
 
-void UsbHandler::processCommand(const std::string& command) {
-    if (command == CommandConfig::SET) {
-        handleSet();
-    } else if (command == CommandConfig::GET) {
-        handleGet();
-    } else if (command == CommandConfig::DELETE) {
-        handleDelete();
-    } else if (command == CommandConfig::DATA) {
-        handleData();
-    } else if (command == CommandConfig::ZIPPED) {
-        handleZippedData();
-    } else if (command == CommandConfig::RESET || command == CommandConfig::BOOTLOADER) {
-        handleSystemCommand(command);
-    } else if (command == CommandConfig::IPV4) {
-        matrix::print("IP: " + api_server.ipv4addr());
-    } else if (command == CommandConfig::IPV6) {
-        matrix::print("IPV6: " + api_server.ipv6addr());;
-    } else if (command == CommandConfig::WRITE) {
-        if (kvStore.commitToFlash()) {
-            matrix::print("Config written to flash");
-        } else {
-            matrix::print("Flash already up to date");
+void UsbHandler::consume(Link& link, const uint8_t* data, size_t len) {
+    link.last_byte_us = time_us_32();
+
+    while (len > 0) {
+        switch (link.state) {
+        case Link::State::PREFIX: {
+            if (link.matched == 0) {
+                // ✅ Skip garbage in one scan; only the first byte of the prefix can start a match
+                auto* start = static_cast<const uint8_t*>(memchr(data, MESSAGE_PREFIX[0], len));
+                if (!start) {
+                    return;
+                }
+                len -= start - data;
+                data = start;
+            }
+
+            // ✅ No character of the prefix recurs at its start, so a mismatch never has to back up
+            // further than the byte that broke it: resyncing stays linear in the bytes received
+            uint8_t byte = *data++;
+            len--;
+            if (byte == MESSAGE_PREFIX[link.matched]) {
+                if (++link.matched == PREFIX_LENGTH) {
+                    link.state = Link::State::COMMAND;
+                    link.matched = 0;
+                }
+            } else {
+                link.matched = byte == MESSAGE_PREFIX[0] ? 1 : 0;
+            }
+            break;
         }
-    } else  if (command == CommandConfig::USB_DISCOVERY) {
+
+        case Link::State::COMMAND:
+        case Link::State::ZIP_SIZE:
+        case Link::State::REGION:
+        case Link::State::OVERLAY: {
+            size_t needed = link.state == Link::State::COMMAND ? COMMAND_LEN :
+                            link.state == Link::State::ZIP_SIZE ? ZIP_SIZE_LEN :
+                            link.state == Link::State::OVERLAY ? OVERLAY_LEN : REGION_LEN;
+            size_t take = std::min(needed - link.matched, len);
+            memcpy(link.field + link.matched, data, take);
+            link.matched += take;
+            data += take;
+            len -= take;
+
+            if (link.matched == needed) {
+                link.matched = 0;
+                if (link.state == Link::State::COMMAND) {
+                    const uint8_t* f = link.field;
+                    link.code = (f[0] << 24) | (f[1] << 16) | (f[2] << 8) | f[3];
+                    processCommand(link);
+                } else {
+                    processField(link);
+                }
+            }
+            break;
+        }
+
+        case Link::State::KEY:
+        case Link::State::VALUE: {
+            uint8_t byte = *data++;
+            len--;
+            if (link.state == Link::State::KEY) {
+                bool text = link.code == fourcc(CommandConfig::PRINT) || link.code == fourcc(CommandConfig::OVERLAY_TEXT);
+                size_t max_len = text ? TEXT_LEN : CONFIG_KEY_LEN - 1;
+                if (!processKeyByte(link, link.key, max_len, byte)) {
+                    break;
+                }
+                if (link.code == fourcc(CommandConfig::SET)) {
+                    link.state = Link::State::VALUE;
+                    break;
+                }
+            } else if (!processKeyByte(link, link.value, CONFIG_VALUE_LEN - 1, byte)) {
+                break;
+            }
+
+            // ✅ Same payload as over TCP: the text (after the overlay fields), or key, a colon, then the value if any
+            std::string payload = link.code == fourcc(CommandConfig::PRINT) ? link.key :
+                                  link.code == fourcc(CommandConfig::OVERLAY_TEXT) ?
+                                      std::string(reinterpret_cast<const char*>(link.field), OVERLAY_LEN) + link.key :
+                                  link.key + ":" + link.value;
+            forward(link, link.code, payload.size(), reinterpret_cast<const uint8_t*>(payload.data()), payload.size());
+            break;
+        }
+
+        case Link::State::PAYLOAD: {
+            size_t take = std::min(link.remaining, len);
+            ApiServer::feed_session(link.session, data, take);
+            link.remaining -= take;
+            data += take;
+            len -= take;
+
+            if (link.remaining == 0) {
+                link.state = Link::State::PREFIX;
+            }
+            break;
+        }
+        }
+    }
+}
+
+void UsbHandler::processCommand(Link& link) {
+    for (const UsbFrameCommand& frame : USB_FRAME_COMMANDS) {
+        if (link.code == frame.code) {
+            forward(link, frame.forward_as, static_cast<size_t>(matrix::WIDTH) * matrix::HEIGHT * frame.bits_per_pixel / 8);
+            return;
+        }
+    }
+
+    switch (link.code) {
+    case fourcc(CommandConfig::PALETTE):
+        // ✅ No size on the USB link, always a full palette
+        forward(link, link.code, matrix::PALETTE_SIZE * 4);
+        return;
+    case fourcc(CommandConfig::CALIBRATION):
+        // ✅ No size on the USB link either, always a full set of curves
+        forward(link, link.code, matrix::CALIBRATION_SIZE);
+        return;
+    case fourcc(CommandConfig::ZIPPED):
+    case fourcc(CommandConfig::DELTAZIPPED):
+        link.state = Link::State::ZIP_SIZE;
+        return;
+    case fourcc(CommandConfig::RECT):
+    case fourcc(CommandConfig::SHOWRECT):
+        link.state = Link::State::REGION;
+        return;
+    case fourcc(CommandConfig::OVERLAY_CLEAR):
+        // ✅ Always a region on the USB link, one as large as the panel clears it all
+        forward(link, link.code, REGION_LEN);
+        return;
+    case fourcc(CommandConfig::OVERLAY_TEXT):
+        link.state = Link::State::OVERLAY;
+        return;
+    case fourcc(CommandConfig::SET):
+    case fourcc(CommandConfig::GET):
+    case fourcc(CommandConfig::DELETE):
+    case fourcc(CommandConfig::PRINT):
+        // ✅ Text and key-value fields end at a colon, a backslash escapes the next byte
+        link.key.clear();
+        link.value.clear();
+        link.escaped = false;
+        link.state = Link::State::KEY;
+        return;
+    case fourcc(CommandConfig::USB_DISCOVERY): {
         std::string response = "{"
-            "\"width\":" + std::to_string(matrix::WIDTH) + ","
-            "\"height\":" + std::to_string(matrix::HEIGHT) + ","
+            "\"width\":" + std::to_string(matrix::width()) + ","
+            "\"height\":" + std::to_string(matrix::height()) + ","
             "\"order\":\"" + kvStore.getParam("color_order") + "\","
             "\"rotation\":" + kvStore.getParam("rotation") + ","
             "\"ip\":\"" + kvStore.getParam("port") + "\","
@@ -86,163 +260,144 @@ void UsbHandler::processCommand(const std::string& command) {
         "}";
 
         usb_serial_write(response);
+        link.state = Link::State::PREFIX;
         return;
     }
-}
-
-void UsbHandler::handleSet() {
-    uint8_t config_key_buffer[CONFIG_KEY_LEN];
-    uint8_t config_value_buffer[CONFIG_VALUE_LEN];
-
-    size_t actual_key_length = getUntil(config_key_buffer, CONFIG_KEY_LEN, ':', '\\');
-    if (actual_key_length > 0) {
-        size_t actual_value_length = getUntil(config_value_buffer, CONFIG_VALUE_LEN, ':', '\\');
-        if (actual_value_length > 0) {
-            std::string key(reinterpret_cast<char*>(config_key_buffer), actual_key_length);
-            std::string value(reinterpret_cast<char*>(config_value_buffer), actual_value_length);
-            kvStore.setParam(key, value);
-            matrix::print("Set " + key + " to " + value);
-        }
+#if MULTIVERSE_STATS
+    case fourcc(CommandConfig::STATS):
+    case fourcc(CommandConfig::STATS_BINARY): {
+        // ✅ Answered on the interface that asked, JSON ends in a newline like UDSC
+        bool binary = link.code == fourcc(CommandConfig::STATS_BINARY);
+        std::string response = ApiServer::stats(binary) + (binary ? "" : "\n");
+        reply(link, reinterpret_cast<const uint8_t*>(response.data()), response.size());
+        link.state = Link::State::PREFIX;
+        return;
     }
-}
-
-void UsbHandler::handleGet() {
-    uint8_t config_key_buffer[CONFIG_KEY_LEN];
-    size_t actual_key_length = getUntil(config_key_buffer, CONFIG_KEY_LEN, ':', '\\');
-
-    if (actual_key_length > 0) {
-        std::string key(reinterpret_cast<char*>(config_key_buffer), actual_key_length);
-        matrix::print(key + " = " + kvStore.getParam(key));
+#endif
+    case fourcc(CommandConfig::TRACE): {
+        static uint8_t dump[trace::DUMP_MAX_SIZE];
+        reply(link, dump, trace::dump(dump, sizeof(dump)));
+        link.state = Link::State::PREFIX;
+        return;
     }
-}
-
-void UsbHandler::handleDelete() {
-    uint8_t config_key_buffer[CONFIG_KEY_LEN];
-    size_t actual_key_length = getUntil(config_key_buffer, CONFIG_KEY_LEN, ':', '\\');
-
-    if (actual_key_length > 0) {
-        std::string key(reinterpret_cast<char*>(config_key_buffer), actual_key_length);
-        if (kvStore.deleteParam(key)) {
-            matrix::print("Deleted key: " + key);
-        } else {
-            matrix::print("Key not found: " + key);
-        }
     }
-}
 
-void UsbHandler::handleSystemCommand(const std::string& command) {
-    if (command == CommandConfig::RESET) {
-        matrix::print("RST");
-        sleep_ms(500);
-        save_and_disable_interrupts();
-        rosc_hw->ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB;
-        watchdog_reboot(0, 0, 0);
-    } else if (command == CommandConfig::BOOTLOADER) {
-        matrix::print("USB");
-        sleep_ms(500);
-        save_and_disable_interrupts();
-        rosc_hw->ctrl = ROSC_CTRL_ENABLE_VALUE_ENABLE << ROSC_CTRL_ENABLE_LSB;
-        reset_usb_boot(0, 0);
+    // ✅ Everything else without a payload (sync, clsc, ipv4, ipv6, stor, RSET, BOOT, FACR) is handled by the server
+    const CommandConfig::Command* command = CommandConfig::find(link.code);
+    if (command && !(command->flags & CommandConfig::Flag::PAYLOAD)) {
+        forward(link, link.code, 0);
+    } else {
+        link.state = Link::State::PREFIX;
     }
 }
 
-void UsbHandler::handleData() {
-    if (getBytes(matrix::buffer, matrix::BUFFER_SIZE) == matrix::BUFFER_SIZE) {
-        matrix::update();
-    }
-}
+void UsbHandler::processField(Link& link) {
+    const uint8_t* f = link.field;
 
-void UsbHandler::handleZippedData() {
-    uint32_t compressed_size;
-    if (getBytes(reinterpret_cast<uint8_t*>(&compressed_size), sizeof(compressed_size)) != sizeof(compressed_size)) {
+    if (link.state == Link::State::ZIP_SIZE) {
+        uint32_t compressed_size = f[0] | (f[1] << 8) | (f[2] << 16) | (static_cast<uint32_t>(f[3]) << 24);
+        if (compressed_size == 0 || compressed_size > matrix::BUFFER_SIZE) {
+            abandon(link);
+            return;
+        }
+        forward(link, link.code == fourcc(CommandConfig::DELTAZIPPED) ? fourcc(CommandConfig::SHOWDELTAZIPPED)
+                                                                     : fourcc(CommandConfig::SHOWZIPPED), compressed_size);
         return;
     }
 
-    if (compressed_size > matrix::BUFFER_SIZE) {
+    if (link.state == Link::State::OVERLAY) {
+        // ✅ Kept in `field` while the text is collected like a text command's
+        link.key.clear();
+        link.escaped = false;
+        link.state = Link::State::KEY;
         return;
     }
 
-    uint8_t* compressed_data = (uint8_t*)malloc(compressed_size);
-    if (!compressed_data) {
+    // ✅ The region header is part of the TCP payload too. 16 bit sides can ask for up to 16 GiB, more than the
+    // 32 bit size holds: regions larger than the panel are refused instead of wrapping to a short payload.
+    uint64_t pixels = static_cast<uint64_t>((f[4] << 8) | f[5]) * ((f[6] << 8) | f[7]);
+    if (pixels > static_cast<uint64_t>(matrix::WIDTH) * matrix::HEIGHT) {
+        abandon(link);
         return;
     }
+    forward(link, link.code, REGION_LEN + static_cast<size_t>(pixels) * 4, f, REGION_LEN);
+}
 
-    if (getBytes(compressed_data, compressed_size) != compressed_size) {
-        free(compressed_data);
-        return;
+bool UsbHandler::processKeyByte(Link& link, std::string& field, size_t max_len, uint8_t byte) {
+    if (link.escaped) {
+        link.escaped = false;
+    } else if (byte == '\\') {
+        link.escaped = true;
+        return false;
+    } else if (byte == ':') {
+        return true;
     }
 
-    uLongf decompressed_size = matrix::BUFFER_SIZE;
-    int ret = uncompress(matrix::buffer, &decompressed_size, compressed_data, compressed_size);
-    free(compressed_data);
-
-    if (ret == Z_OK && decompressed_size == matrix::BUFFER_SIZE) {
-        matrix::update();
+    if (field.size() == max_len) {
+        abandon(link);
+        return false;
     }
+    field += static_cast<char>(byte);
+    return false;
 }
 
-bool UsbHandler::waitFor(std::string_view data, uint timeout_ms) {
-    timeout_state ts;
-    absolute_time_t until = delayed_by_ms(get_absolute_time(), timeout_ms);
-    check_timeout_fn check_timeout = init_single_timeout_until(&ts, until);
-
-    for (auto expected_char : data) {
-        char got_char;
-        while (1) {
-            tud_task();
-            if (cdc_task(reinterpret_cast<uint8_t*>(&got_char), 1) == 1) break;
-            if (check_timeout(&ts, until)) return false;
-        }
-        if (got_char != expected_char) return false;
+void UsbHandler::forward(Link& link, uint32_t code, size_t size, const uint8_t* data, size_t len) {
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, MESSAGE_PREFIX, PREFIX_LENGTH);
+    header[PREFIX_LENGTH] = size >> 24;
+    header[PREFIX_LENGTH + 1] = size >> 16;
+    header[PREFIX_LENGTH + 2] = size >> 8;
+    header[PREFIX_LENGTH + 3] = size;
+    header[PREFIX_LENGTH + 4] = code >> 24;
+    header[PREFIX_LENGTH + 5] = code >> 16;
+    header[PREFIX_LENGTH + 6] = code >> 8;
+    header[PREFIX_LENGTH + 7] = code;
+
+    ApiServer::feed_session(link.session, header, HEADER_SIZE);
+    if (len > 0) {
+        ApiServer::feed_session(link.session, data, len);
     }
-    return true;
-}
-
-size_t UsbHandler::getBytes(uint8_t* buffer, size_t len, uint timeout_ms) {
-    memset(buffer, 0, len);
-    timeout_state ts;
-    absolute_time_t until = delayed_by_ms(get_absolute_time(), timeout_ms);
-    check_timeout_fn check_timeout = init_single_timeout_until(&ts, until);
 
-    size_t bytes_remaining = len;
-    uint8_t* p = buffer;
-    while (bytes_remaining && !check_timeout(&ts, until)) {
-        tud_task();
-        size_t bytes_read = cdc_task(p, std::min(bytes_remaining, MAX_UART_PACKET));
-        bytes_remaining -= bytes_read;
-        p += bytes_read;
-    }
-    return len - bytes_remaining;
+    link.remaining = size - len;
+    link.state = link.remaining > 0 ? Link::State::PAYLOAD : Link::State::PREFIX;
 }
 
-size_t UsbHandler::getUntil(uint8_t* buffer, size_t max_len, uint8_t separator, uint8_t escape, uint timeout_ms) {
-    size_t index = 0;
-    bool escaped = false;
+// ✅ Larger than the endpoint FIFOs, so keeps the stack running while they drain; gives up on a stalled host
+void UsbHandler::reply(Link& link, const uint8_t* data, size_t len) {
+    bool on_vendor = &link == &vendor;
+    uint32_t started = time_us_32();
 
-    timeout_state ts;
-    absolute_time_t until = delayed_by_ms(get_absolute_time(), timeout_ms);
-    check_timeout_fn check_timeout = init_single_timeout_until(&ts, until);
-
-    while (index < max_len - 1 && !check_timeout(&ts, until)) {
-        tud_task();
-
-        uint8_t byte;
-        if (getBytes(&byte, 1) == 0) {
-            continue;
+    while (len > 0 && time_us_32() - started < USB_MESSAGE_TIMEOUT_US) {
+        if (on_vendor ? !tud_vendor_mounted() : !tud_cdc_connected()) {
+            return;
         }
-
-        if (escaped) {
-            escaped = false;
-        } else if (byte == escape) {
-            escaped = true;
-            continue;
-        } else if (byte == separator) {
-            break;
+        size_t written;
+        if (on_vendor) {
+            written = tud_vendor_write(data, len);
+            tud_vendor_write_flush();
+        } else {
+            written = tud_cdc_write(data, len);
+            tud_cdc_write_flush();
+        }
+        data += written;
+        len -= written;
+        if (len > 0) {
+            tud_task();
         }
-
-        buffer[index++] = byte;
     }
+}
+
+// ✅ The server answering a message forwarded from `context`'s link
+void UsbHandler::session_reply(void* context, const uint8_t* data, size_t len) {
+    Link* link = static_cast<Link*>(context);
+    link->handler->reply(*link, data, len);
+}
 
-    buffer[index] = '\0';
-    return index;
-}
\ No newline at end of file
+void UsbHandler::abandon(Link& link) {
+    trace::log(trace::Event::USB_ABANDON, &link == &vendor, static_cast<uint32_t>(link.state));
+    // ✅ Drops a partial message in the session too, which releases the framebuffer and core 1's inflater
+    ApiServer::reset_session(link.session);
+    link.state = Link::State::PREFIX;
+    link.matched = 0;
+    link.remaining = 0;
+}
@@ -9,24 +9,42 @@
 class UsbHandler {
 public:
     explicit UsbHandler(KVStore& kvStore, ApiServer& api_server);
-    
+
     void start();
-    void processCommand(const std::string& command);
+    void poll();  // Handles whatever has arrived on either interface, never waits for more
 
 private:
+    // USB commands carry no size, the parser works it out from the command and forwards the message with a
+    // TCP header to an ApiServer session. Each interface keeps its own parser, a message never spans the two.
+    struct Link {
+        enum class State { PREFIX, COMMAND, ZIP_SIZE, REGION, OVERLAY, KEY, VALUE, PAYLOAD };
+        State state = State::PREFIX;
+        size_t matched = 0;         // Bytes of the prefix (or of the fixed-size field being collected) seen
+        uint8_t field[16];
+        uint32_t code = 0;          // Command
+        std::string key;
+        std::string value;
+        bool escaped = false;
+        size_t remaining = 0;       // Payload bytes still to forward
+        uint32_t last_byte_us = 0;
+        RecvState* session = nullptr;
+        UsbHandler* handler = nullptr;  // Answers the session's replies on this link's interface
+    };
+
     KVStore& kvStore;
     ApiServer& api_server;
+    Link cdc;
+    Link vendor;
 
-    bool waitFor(std::string_view data, uint timeout_ms = 1000);
-    size_t getBytes(uint8_t* buffer, size_t len, uint timeout_ms = 1000);
-    size_t getUntil(uint8_t* buffer, size_t max_len, uint8_t separator, uint8_t escape, uint timeout_ms = 1000);
-
-    void handleSet();
-    void handleGet();
-    void handleDelete();
-    void handleData();
-    void handleZippedData();
-    void handleSystemCommand(const std::string& command);
+    void receive(Link& link, size_t (*read)(uint8_t* data, size_t len));
+    void consume(Link& link, const uint8_t* data, size_t len);
+    void processCommand(Link& link);
+    void processField(Link& link);
+    bool processKeyByte(Link& link, std::string& field, size_t max_len, uint8_t byte);
+    void forward(Link& link, uint32_t code, size_t size, const uint8_t* data = nullptr, size_t len = 0);
+    void reply(Link& link, const uint8_t* data, size_t len);  // To the interface the link reads from
+    static void session_reply(void* context, const uint8_t* data, size_t len);
+    void abandon(Link& link);
 };
 
-#endif // USB_HANDLER_HPP
\ No newline at end of file
+#endif // USB_HANDLER_HPP